@@ -7,27 +7,213 @@
 // [copri](copri.html) library.
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <unistd.h>
 #include <gmp.h>
 #include "copri.h"
+#include "divide_conquer.h"
+#include "hash.h"
+#include "source.h"
 #include "config.h"
+#if USE_OPENMP
+#include <omp.h>
+#endif
+
+// #### input indices
+// With `-u` the results are reported with the indices of the integer in
+// every input file. `sources` is the sidecar written by `csv2gmp -s` or
+// NULL.
+static void print_indices(key_index *idx, source_map *sources, int file, const mpz_t key, int jflg) {
+	const size_t *indices;
+	uint64_t offset;
+	size_t n, i;
+
+	if ((n = keyindex_find(idx, key, &indices)) == 0)
+		return;
+	if (jflg > 0)
+		printf(",\"indices%d\":[", file);
+	else
+		printf("at index ");
+	for (i = 0; i < n; i++)
+		printf(i > 0 ? (jflg > 0 ? ",%zu" : ", %zu") : "%zu", indices[i]);
+	if (sources != NULL) {
+		if (jflg > 0)
+			printf("],\"sources%d\":[", file);
+		else
+			printf(" of file %d\nat csv offset ", file);
+		for (i = 0; i < n; i++) {
+			offset = source_offset(sources, indices[i]);
+			if (i > 0)
+				printf(jflg > 0 ? "," : ", ");
+			if (offset == SOURCE_NONE)
+				printf(jflg > 0 ? "null" : "?");
+			else
+				printf("%llu", (unsigned long long)offset);
+		}
+		printf(jflg > 0 ? "]" : "\n");
+	} else {
+		if (jflg > 0)
+			printf("]");
+		else
+			printf(" of file %d\n", file);
+	}
+}
+
+// #### input files
+// An input file with its integers. With `-u` the integers of the file are
+// indexed by `idx`, the index of every file but the first one needs its
+// own copy `keys` of the integers, because integers which are in an
+// earlier file are removed from `s`.
+typedef struct {
+	char *file;
+	char *source;
+	mpz_array s, keys;
+	size_t count, loaded;
+	key_index idx;
+	source_map src;
+} merge_input;
+
+static merge_input *inputs;
+
+// The coprime base of a single file, the leaf of the merge tree.
+static void merge_leaf(mpz_pool *pool, mpz_array *ret, mpz_t *s, size_t i) {
+	array_add_array(ret, &inputs[i].s);
+}
+
+// Merge the coprime bases of the files `from..to` by `cbmerge`. A file may
+// be empty if all its integers are in earlier files.
+static void merge_bases(mpz_pool *pool, mpz_array *ret, mpz_array *p, mpz_array *q,
+mpz_t *s, size_t from, size_t to, int depth) {
+	if (p->used && q->used)
+		cbmerge(pool, ret, p, q);
+	else if (p->used)
+		array_add_array(ret, p);
+	else
+		array_add_array(ret, q);
+}
+
+// #### delta factor extraction
+// Almost all elements of the merged base `p` are integers of the files.
+// Only an integer which is not in `p` anymore has a nontrivial
+// factorization, and it factors over the new elements of `p` (those which
+// are in no file) and over elements of other files which divide it. Find
+// these changed integers, the changed integers of file k are
+// changed[from[k]..from[k+1]-1], and the elements of `p` which divide
+// them. The latter are added to `base` in the order of `p`.
+//
+// The part of a changed integer coprime to the new elements is usually 1
+// or a single element of `p`, which is looked up in a hash set. Anything
+// else is screened against all of `p`. Returns the number of changed
+// integers.
+static size_t merge_delta(mpz_pool *pool, mpz_array *changed, size_t *from, mpz_array *base, mpz_array *p, size_t n) {
+	mpz_hashset h;
+	mpz_array fresh, rem, rest, g;
+	mpz_t x, y, r;
+	char *mark;
+	size_t i, j, k;
+
+	// Look up the integers of the files in `p`, the marked elements are
+	// in a file.
+	mark = (char *)calloc(p->used + 1, 1);
+	hashset_init(&h, p, p->used);
+	for (j = 0; j < p->used; j++)
+		hashset_add(&h, j);
+	for (k = 0; k < n; k++) {
+		from[k] = changed->used;
+		for (i = 0; i < inputs[k].s.used; i++) {
+			j = hashset_find(&h, inputs[k].s.array[i]);
+			if (j == HASHSET_NONE)
+				array_add(changed, inputs[k].s.array[i]);
+			else
+				mark[j] = 1;
+		}
+	}
+	from[n] = changed->used;
+
+	if (changed->used > 0) {
+		pool_pop(pool, x);
+		pool_pop(pool, y);
+		pool_pop(pool, r);
+
+		// Remove the new elements from every changed integer by
+		// r ← ppo(a, prod{new}), the product is reduced mod a first.
+		array_init(&fresh, 10);
+		for (j = 0; j < p->used; j++) {
+			if (mark[j] == 0) {
+				array_add(&fresh, p->array[j]);
+				mark[j] = 2;
+			}
+		}
+		array_init(&rem, changed->used);
+		if (fresh.used > 0) {
+			array_prod(pool, &fresh, x);
+			array_remainders(pool, &rem, x, changed);
+		}
+		array_init(&rest, 10);
+		for (i = 0; i < changed->used; i++) {
+			if (fresh.used > 0)
+				ppi_ppo(pool, y, r, changed->array[i], rem.array[i]);
+			else
+				mpz_set(r, changed->array[i]);
+			if (mpz_cmp_ui(r, 1) == 0)
+				continue;
+			if ((j = hashset_find(&h, r)) != HASHSET_NONE)
+				mark[j] = 2;
+			else
+				array_add(&rest, r);
+		}
+
+		// Screen `p` for the elements which divide the remaining parts.
+		if (rest.used > 0) {
+			array_init(&g, p->used);
+			array_prod(pool, &rest, y);
+			array_screen(pool, &g, y, p);
+			for (j = 0; j < p->used; j++) {
+				if (mpz_cmp_ui(g.array[j], 1) != 0)
+					mark[j] = 2;
+			}
+			array_clear(&g);
+		}
+
+		for (j = 0; j < p->used; j++) {
+			if (mark[j] == 2)
+				array_add(base, p->array[j]);
+		}
+
+		array_clear(&fresh);
+		array_clear(&rem);
+		array_clear(&rest);
+		pool_push(pool, x);
+		pool_push(pool, y);
+		pool_push(pool, r);
+	}
+
+	hashset_clear(&h);
+	free(mark);
+	return changed->used;
+}
 
 // The generic `main` function.
 //
 // Define all variables at the beginning to make the C99 compiler
 // happy.
 int main(int argc, char **argv) {
-	mpz_array s1, s2, p, out;
+	mpz_array p, out, seen, changed, base;
 	mpz_pool pool;
-	size_t c1, c2, i;
-	int c, vflg = 0, sflg = 0, rflg = 0, jflg = 0, errflg = 0, r = 0;
-	char *file1 = "primes1.lst";
-	char *file2 = "primes2.lst";
+	mpz_hashset h;
+	size_t n = 0, total = 0, sources = 0, i, k, dups, *from;
+	int c, vflg = 0, sflg = 0, rflg = 0, jflg = 0, uflg = 0, errflg = 0, r = 0;
+	char *defaults[] = { "primes1.lst", "primes2.lst" };
+	char **files = defaults, **source_files;
 	char *cb_file = NULL;
+	char *source2 = NULL;
+
+	source_files = (char **)calloc(argc + 2, sizeof(char *));
 
 	// #### argument parsing
-	// Boring `getopt` argument parsing.
-	while ((c = getopt(argc, argv, ":svrjb:")) != -1) {
+	// Boring `getopt` argument parsing. The k-th `-S` belongs to the k-th
+	// file, `-T` to the second one.
+	while ((c = getopt(argc, argv, ":svrjub:S:T:")) != -1) {
 		switch(c) {
 		case 'b':
 			cb_file = optarg;
@@ -44,6 +230,17 @@ int main(int argc, char **argv) {
 		case 'j':
 			jflg++;
 			break;
+		case 'u':
+			uflg++;
+			break;
+		case 'S':
+			source_files[sources++] = optarg;
+			uflg++;
+			break;
+		case 'T':
+			source2 = optarg;
+			uflg++;
+			break;
 		case ':':
 			fprintf(stderr, "Option -%c requires an operand\n", optopt);
 			errflg++;
@@ -55,9 +252,24 @@ int main(int argc, char **argv) {
 	}
 
 	if (optind < argc) {
-		file1 = argv[optind];
-		file2 = argv[optind+1];
-		if (optind + 2 < argc) errflg++;
+		files = &argv[optind];
+		n = argc - optind;
+		if (n < 2) errflg++;
+	} else {
+		n = 2;
+	}
+	// `-T` is the sidecar of file 2, the only `-S` is the one of file 1.
+	if (source2 != NULL) {
+		if (sources > 1) {
+			fprintf(stderr, "\n\t-T can't be used with more than one -S!\n\n");
+			errflg++;
+		} else {
+			source_files[1] = source2;
+		}
+	}
+	if (sources > n) {
+		fprintf(stderr, "\n\tmore sidecars than files!\n\n");
+		errflg++;
 	}
 
 	if (rflg && vflg) {
@@ -67,12 +279,15 @@ int main(int argc, char **argv) {
 
 	// Print the usage and exit if an error occurred during argument parsing.
 	if (errflg) {
-		fprintf(stderr, "usage: [-vsr] [-b out-file] [cb-file1] [cb-file1]\n"\
+		fprintf(stderr, "usage: [-vsru] [-b out-file] [-S source] [-T source2] [cb-file1] [cb-file2] [cb-file3 ...]\n"\
                         "\n\t-b FILE   store the coprime base in FILE"\
                         "\n\t-v        be more verbose"\
 						"\n\t-j        use json as output format"\
                         "\n\t-r        output the found coprimes in raw gmp format"\
                         "\n\t-s        only check if there are coprimes"\
+                        "\n\t-u        report the indices of the results in every file"\
+                        "\n\t-S FILE   report the csv offsets of the next file from the csv2gmp sidecar FILE, implies -u"\
+                        "\n\t-T FILE   report the csv offsets of file 2 from the csv2gmp sidecar FILE, implies -u"\
                         "\n\n");
 		exit(2);
 	}
@@ -84,39 +299,111 @@ int main(int argc, char **argv) {
 #endif
 	}
 
-	// Load the keys.
-	array_init(&s1, 10);
-	c1 = array_of_file(&s1, file1);
-	array_init(&s2, 10);
-	c2 = array_of_file(&s2, file2);
+	inputs = (merge_input *)calloc(n, sizeof(merge_input));
+	for (k = 0; k < n; k++) {
+		inputs[k].file = files[k];
+		inputs[k].source = source_files[k];
+	}
+	free(source_files);
+
+	// Map the sidecars.
+	for (k = 0; k < n; k++) {
+		if (inputs[k].source != NULL && !source_open(&inputs[k].src, inputs[k].source)) {
+			fprintf(stderr, "Can't load %s\n", inputs[k].source);
+			return 1;
+		}
+	}
+
+	// Load the keys and remove the duplicates of every file in parallel.
+	// With `-u` the indices of the integers are kept by an index of each
+	// file.
+#if USE_OPENMP
+	#pragma omp parallel for schedule(dynamic)
+#endif
+	for (k = 0; k < n; k++) {
+		merge_input *in = &inputs[k];
+		size_t *map = NULL;
+
+		array_init(&in->s, 10);
+		in->count = array_of_file(&in->s, in->file);
+		in->loaded = in->s.used;
+		if (in->count == 0 || in->loaded != in->count)
+			continue;
+		if (uflg > 0)
+			map = (size_t *)malloc(in->count * sizeof(size_t));
+		array_dedup(&in->s, map);
+		if (uflg > 0) {
+			if (k > 0) {
+				array_init(&in->keys, in->s.used);
+				array_copy(&in->keys, &in->s);
+				keyindex_init(&in->idx, &in->keys, map, in->count);
+			} else {
+				keyindex_init(&in->idx, &in->s, map, in->count);
+			}
+			free(map);
+		}
+	}
 
-	pool_init(&pool, c1);
-	if (c1 == 0) {
-		fprintf(stderr, "Can't load %s\n", file1);
-		return 1;
+	dups = 0;
+	for (k = 0; k < n; k++) {
+		if (inputs[k].count == 0) {
+			fprintf(stderr, "Can't load %s\n", inputs[k].file);
+			return 1;
+		}
+		if (inputs[k].loaded != inputs[k].count) {
+			fprintf(stderr, "Array size and load count do not match\n");
+			return 2;
+		}
+		dups += inputs[k].count - inputs[k].s.used;
 	}
-	if (c2 == 0) {
-		fprintf(stderr, "Can't load %s\n", file2);
-		return 1;
+	pool_init(&pool, inputs[0].count);
+
+	// Integers in more than one file would be counted twice by the check
+	// for new coprime pairs below. Remove them from all but the first file
+	// which has them, they are factored with that file.
+	array_init(&seen, inputs[0].s.used);
+	hashset_init(&h, &seen, inputs[0].s.used);
+	for (k = 0; k < n; k++) {
+		if (k > 0)
+			dups += array_remove_set(&inputs[k].s, &h);
+		if (k + 1 < n) {
+			for (i = 0; i < inputs[k].s.used; i++) {
+				array_add(&seen, inputs[k].s.array[i]);
+				hashset_add(&h, seen.used - 1);
+			}
+		}
+		total += inputs[k].s.used;
 	}
-	if (s1.used != c1 ||  s2.used != c2) {
-		fprintf(stderr, "Array size and load count do not match\n");
-		return 2;
+	hashset_clear(&h);
+	array_clear(&seen);
+	if (vflg > 0 && jflg == 0 && dups > 0) {
+		printf("%zu duplicate integers removed\n", dups);
+	} else if (jflg > 0 && dups > 0) {
+		printf("{\"type\":\"info\",\"msg\":\"Duplicates removed\",\"count\":%zu}\n", dups);
+		fflush(stdout);
 	}
+
 	// Print the key count.
 	if (vflg > 0 && jflg == 0) {
-		printf("coprime base 1 size: %zu\ncoprime base 2 size: %zu\n", s1.used, s2.used);
+		for (k = 0; k < n; k++)
+			printf("coprime base %zu size: %zu\n", k + 1, inputs[k].s.used);
 		if (cb_file != NULL)
 			printf("cb is going to be saved in '%s'\n", cb_file);
 		printf("Starting factorization...\n");
 	} else if (jflg > 0) {
-		printf("{\"type\":\"start\",\"msg\":\"Starting factorization\",\"count\":[%zu,%zu]}\n", s1.used, s2.used);
+		printf("{\"type\":\"start\",\"msg\":\"Starting factorization\",\"count\":[");
+		for (k = 0; k < n; k++)
+			printf(k > 0 ? ",%zu" : "%zu", inputs[k].s.used);
+		printf("]}\n");
 		fflush(stdout);
 	}
 
-	// Computing a coprime base for a finite set [Algorithm 18.1](copri.html#computing-a-coprime-base-for-a-finite-set).
-	array_init(&p, s1.used+s2.used);
-	cbmerge(&pool, &p, &s1, &s2);
+	// Merge the coprime bases of the files over a balanced tree by
+	// [divide_conquer_bases](divide_conquer.html), the merges of
+	// independent subtrees run in parallel and the intermediate bases stay
+	// in memory.
+	array_init(&p, total);
+	divide_conquer_bases(&pool, &p, NULL, 0, n - 1, NULL, merge_leaf, merge_bases);
 
 	if (cb_file != NULL) {
 		if (vflg > 0) {
@@ -131,8 +418,12 @@ int main(int argc, char **argv) {
 	}
 
 
-	// Check if we have found more coprime bases.
-	if (p.used == s1.used + s2.used) {
+	// Check if we have found more coprime bases. These are the integers of
+	// the files which are not in the merged base anymore.
+	array_init(&changed, 10);
+	array_init(&base, 10);
+	from = (size_t *)malloc((n + 1) * sizeof(size_t));
+	if (merge_delta(&pool, &changed, from, &base, &p, n) == 0) {
 		if (vflg > 0) {
 			if (jflg == 0) {
 				printf("No coprime pairs found :-(\n");
@@ -144,10 +435,10 @@ int main(int argc, char **argv) {
 		r = 0;
 	} else {
 		if (vflg > 0 && jflg == 0) {
-			printf("Found ~%zu coprime pairs!!!\n", (p.used - (s1.used + s2.used)));
+			printf("Found ~%zu coprime pairs!!!\n", changed.used);
 		}
 		if (jflg > 0) {
-			printf("{\"type\":\"interim result\",\"msg\":\"Found coprime pairs\",\"count\":%zu}\n", (p.used - (s1.used + s2.used)));
+			printf("{\"type\":\"interim result\",\"msg\":\"Found coprime pairs\",\"count\":%zu}\n", changed.used);
 			fflush(stdout);
 		}
 		if (sflg == 0) {
@@ -161,32 +452,58 @@ int main(int argc, char **argv) {
 			}
 			array_init(&out, 9);
 			// Use [Algorithm 21.2](copri.html#factoring-a-set-over-a-coprime-base) to find the coprimes in the coprime base.
-			array_find_factors(&pool, &out, &s1, &p);
-			array_find_factors(&pool, &out, &s2, &p);
+			// Only the changed integers of every file are factored, over the
+			// elements of the merged base which divide them.
+			for (k = 0; k < n; k++) {
+				if (from[k + 1] > from[k])
+					find_factors(&pool, &out, changed.array, from[k], from[k + 1] - 1, &base);
+			}
 			// Output the factors.
 			if (out.used > 0) {
 				if ((out.used % 3) != 0) {
 					fprintf(stderr, "Find factors returned an invalid array\n");
 				} else {
 					if (jflg > 0) {
-						for(i = 0; i < out.used; i+=3)
-							gmp_printf("{\"type\":\"result\",\"msg\":\"Found factors\",\"key\":\"%Zu\",\"p\":\"%Zu\",\"q\":\"%Zu\"}\n", out.array[i], out.array[i+1], out.array[i+2]);
+						for(i = 0; i < out.used; i+=3) {
+							gmp_printf("{\"type\":\"result\",\"msg\":\"Found factors\",\"key\":\"%Zu\",\"p\":\"%Zu\",\"q\":\"%Zu\"", out.array[i], out.array[i+1], out.array[i+2]);
+							if (uflg > 0) {
+								for (k = 0; k < n; k++)
+									print_indices(&inputs[k].idx, inputs[k].source != NULL ? &inputs[k].src : NULL, k + 1, out.array[i], jflg);
+							}
+							printf("}\n");
+						}
 					} else if (rflg > 0) {
 						for(i = 0; i < out.used; i++)
 							mpz_out_raw(stdout, out.array[i]);
 					} else {
-						for(i = 0; i < out.used; i+=3)
+						for(i = 0; i < out.used; i+=3) {
 							gmp_printf("\n### Found factors of\n%Zu\n=\n%Zu\nx\n%Zu\n", out.array[i], out.array[i+1], out.array[i+2]);
+							if (uflg > 0) {
+								for (k = 0; k < n; k++)
+									print_indices(&inputs[k].idx, inputs[k].source != NULL ? &inputs[k].src : NULL, k + 1, out.array[i], jflg);
+							}
+						}
 					}
 				}
 			}
 			array_clear(&out);
 		}
 	}
+	array_clear(&changed);
+	array_clear(&base);
+	free(from);
 
 	array_clear(&p);
-	array_clear(&s1);
-	array_clear(&s2);
+	for (k = 0; k < n; k++) {
+		if (uflg > 0) {
+			keyindex_clear(&inputs[k].idx);
+			if (k > 0)
+				array_clear(&inputs[k].keys);
+		}
+		source_close(&inputs[k].src);
+		array_clear(&inputs[k].s);
+	}
+	free(inputs);
 	if (vflg > 0 && jflg == 0)
 		pool_inspect(&pool);
 	pool_clear(&pool);
@@ -4,25 +4,88 @@
 // See the lgpl.txt file in the root directory or <https://www.gnu.org/licenses/lgpl>.
 
 // This app implements a n^2 test application.
+//
+// The keys are split into tiles of `-t` keys and the product of every tile
+// is computed once. Key i shares a factor with a key of tile J if and only
+// if gcd(prod(J) mod n_i, n_i) != 1, so a single remainder and gcd check a
+// whole tile. Only the keys of tiles which pass this test are checked one
+// by one. The rows are processed in parallel and the pairs are printed in
+// the same (i, j) order as the plain double loop.
 #include <stdlib.h>
 #include <stdio.h>
 #include <unistd.h>
 #include <gmp.h>
 #include "copri.h"
+#include "kernel.h"
+#include "config.h"
+#if USE_OPENMP
+#include <omp.h>
+#endif
 
-int main(int argc, char **argv) {
-	mpz_array s;
+#define TILE_DEFAULT_SIZE 32
+
+// A pair of keys sharing the factor g.
+typedef struct {
+	size_t i;
+	size_t j;
 	mpz_t g;
-	size_t count, i, j;
+} n2_hit;
+
+typedef struct {
+	n2_hit *hits;
+	size_t used;
+	size_t size;
+} n2_hits;
+
+static void hits_add(n2_hits *h, size_t i, size_t j, const mpz_t g) {
+	if (h->used >= h->size) {
+		h->size = h->size ? 2 * h->size : 16;
+		h->hits = (n2_hit *)realloc(h->hits, h->size * sizeof(n2_hit));
+	}
+	h->hits[h->used].i = i;
+	h->hits[h->used].j = j;
+	mpz_init_set(h->hits[h->used].g, g);
+	h->used++;
+}
+
+static int hits_cmp(const void *a, const void *b) {
+	const n2_hit *x = (const n2_hit *)a, *y = (const n2_hit *)b;
+	if (x->i != y->i) return x->i < y->i ? -1 : 1;
+	if (x->j != y->j) return x->j < y->j ? -1 : 1;
+	return 0;
+}
+
+// Check the keys j of [from, to] with j > i one by one.
+static void check_keys(n2_hits *h, mpz_array *s, size_t i, size_t from, size_t to, mpz_t g) {
+	size_t j;
+	for (j = (from > i ? from : i + 1); j <= to; j++) {
+		kernel_gcd(g, s->array[i], s->array[j]);
+		if (mpz_cmp_ui(g, 1) != 0) {
+			hits_add(h, i, j, g);
+		}
+	}
+}
+
+int main(int argc, char **argv) {
+	mpz_array s, tiles;
+	mpz_pool pool;
+	n2_hits all;
+	size_t count, k, ntiles, tile = TILE_DEFAULT_SIZE;
 
 	int c, vflg = 0, errflg = 0;
+	long int t;
 	char *filename = "primes.lst";
 
-	while ((c = getopt(argc, argv, ":sv")) != -1) {
+	while ((c = getopt(argc, argv, ":svt:")) != -1) {
 		switch(c) {
 		case 'v':
 			vflg++;
 			break;
+		case 't':
+			t = strtol(optarg, NULL, 0);
+			if (t < 1) errflg++;
+			else tile = (size_t)t;
+			break;
 		case ':':
 			fprintf(stderr, "Option -%c requires an operand\n", optopt);
 			errflg++;
@@ -40,14 +103,14 @@ int main(int argc, char **argv) {
 
 	// Print the usage and exit if an error occurred during argument parsing.
 	if (errflg) {
-		fprintf(stderr, "usage: [-v] [file]\n"\
+		fprintf(stderr, "usage: [-v] [-t SIZE] [file]\n"\
 						"\n\t-v        be more verbose"\
+						"\n\t-t SIZE   check the keys in tiles of SIZE keys (default 32)"\
 						"\n\n");
 		exit(2);
 	}
 
 	array_init(&s, 10);
-	mpz_init(g);
 
 	count = array_of_file(&s, filename);
 	if (count == 0) {
@@ -66,19 +129,89 @@ int main(int argc, char **argv) {
 		printf("Loaded %zu primes\nStarting factorization...\n", s.used);
 	}
 
-	for(i = 0; i < s.used; i++) {
-		for(j = 0; j < s.used; j++) {
-			if (j > i) {
-				mpz_gcd(g, s.array[i], s.array[j]);
+	// Compute the tile products.
+	ntiles = (s.used + tile - 1) / tile;
+	array_init(&tiles, ntiles);
+	for (k = 0; k < ntiles; k++) {
+		mpz_init(tiles.array[k]);
+	}
+	tiles.used = ntiles;
+#if USE_OPENMP
+	#pragma omp parallel private(pool)
+#endif
+	{
+		pool_init(&pool, 0);
+#if USE_OPENMP
+		#pragma omp for schedule(dynamic)
+#endif
+		for (k = 0; k < ntiles; k++) {
+			prod(&pool, tiles.array[k], s.array, k * tile,
+				(k + 1) * tile < s.used ? (k + 1) * tile - 1 : s.used - 1);
+		}
+		pool_clear(&pool);
+	}
+	if (vflg > 0) {
+		printf("Computed %zu tile products of %zu keys\n", ntiles, tile);
+	}
+
+	// Check the rows. Every thread collects its pairs, they are sorted
+	// afterwards.
+	all.hits = NULL;
+	all.used = all.size = 0;
+#if USE_OPENMP
+	#pragma omp parallel private(k)
+#endif
+	{
+		n2_hits h;
+		mpz_t r, g;
+		size_t row, last;
+
+		h.hits = NULL;
+		h.used = h.size = 0;
+		mpz_init(r);
+		mpz_init(g);
+#if USE_OPENMP
+		#pragma omp for schedule(dynamic, 16)
+#endif
+		for (row = 0; row < s.used; row++) {
+			// The rest of the own tile is checked directly.
+			k = row / tile;
+			last = (k + 1) * tile < s.used ? (k + 1) * tile - 1 : s.used - 1;
+			check_keys(&h, &s, row, row + 1, last, g);
+
+			for (k = k + 1; k < ntiles; k++) {
+				mpz_mod(r, tiles.array[k], s.array[row]);
+				kernel_gcd(g, r, s.array[row]);
 				if (mpz_cmp_ui(g, 1) != 0) {
-					gmp_printf("Found coprime ----\n%Zu\nand\n%Zu\nshare\n%Zu\n----\n", s.array[i], s.array[j], g);
+					last = (k + 1) * tile < s.used ? (k + 1) * tile - 1 : s.used - 1;
+					check_keys(&h, &s, row, k * tile, last, g);
 				}
 			}
 		}
+#if USE_OPENMP
+		#pragma omp critical (n2_hits)
+#endif
+		{
+			for (k = 0; k < h.used; k++) {
+				hits_add(&all, h.hits[k].i, h.hits[k].j, h.hits[k].g);
+				mpz_clear(h.hits[k].g);
+			}
+		}
+		free(h.hits);
+		mpz_clear(r);
+		mpz_clear(g);
+	}
+
+	qsort(all.hits, all.used, sizeof(n2_hit), hits_cmp);
+	for (k = 0; k < all.used; k++) {
+		gmp_printf("Found coprime ----\n%Zu\nand\n%Zu\nshare\n%Zu\n----\n",
+			s.array[all.hits[k].i], s.array[all.hits[k].j], all.hits[k].g);
+		mpz_clear(all.hits[k].g);
 	}
+	free(all.hits);
 
+	array_clear(&tiles);
 	array_clear(&s);
-	mpz_clear(g);
 
 	return 0;
 }
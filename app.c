@@ -10,6 +10,9 @@
 #include <unistd.h>
 #include <gmp.h>
 #include "copri.h"
+#include "memory.h"
+#include "hash.h"
+#include "source.h"
 #include "config.h"
 
 // Start by defining an neat looking banner.
@@ -31,21 +34,237 @@
 "        Algorithm by Daniel J. Bernstein           \n"\
 "   http://cr.yp.to/lineartime/dcba-20040404.pdf    \n\n");
 
+// #### duplicate keys
+// With `-u` the duplicates are removed while loading. The [key index](hash.html#key-index)
+// maps every unique key back to all its indices in the input file, so the
+// results are reported for every occurrence. With `-S` the indices are
+// also looked up in the sidecar written by `csv2gmp -s`.
+static source_map *key_sources = NULL;
+
+// Print the input indices of a key and their csv offsets, nothing if it is
+// not an input key.
+static void print_indices(key_index *idx, const mpz_t key, int jflg) {
+	const size_t *indices;
+	uint64_t offset;
+	size_t n, i;
+
+	if (idx == NULL || (n = keyindex_find(idx, key, &indices)) == 0)
+		return;
+	printf(jflg > 0 ? ",\"indices\":[" : "at index ");
+	for (i = 0; i < n; i++)
+		printf(i > 0 ? (jflg > 0 ? ",%zu" : ", %zu") : "%zu", indices[i]);
+	if (key_sources != NULL) {
+		printf(jflg > 0 ? "],\"sources\":[" : "\nat csv offset ");
+		for (i = 0; i < n; i++) {
+			offset = source_offset(key_sources, indices[i]);
+			if (i > 0)
+				printf(jflg > 0 ? "," : ", ");
+			if (offset == SOURCE_NONE)
+				printf(jflg > 0 ? "null" : "?");
+			else
+				printf("%llu", (unsigned long long)offset);
+		}
+	}
+	printf(jflg > 0 ? "]" : "\n");
+}
+
+// Report the keys which occur more than once in the input file.
+static void print_duplicates(key_index *idx, int jflg, int rflg) {
+	size_t k;
+
+	for (k = 0; rflg == 0 && k < idx->keys.used; k++) {
+		if (idx->offsets[k + 1] - idx->offsets[k] < 2)
+			continue;
+		if (jflg > 0) {
+			gmp_printf("{\"type\":\"duplicate\",\"key\":\"%Zu\"", idx->keys.array[k]);
+			print_indices(idx, idx->keys.array[k], jflg);
+			printf("}\n");
+		} else {
+			gmp_printf("\n### Duplicate key\n%Zu\n", idx->keys.array[k]);
+			print_indices(idx, idx->keys.array[k], jflg);
+		}
+	}
+	fflush(stdout);
+}
+
+// Print the triples (key, p, q) found by `find_factors`.
+static void print_factors(mpz_array *out, const char *msg, int jflg, int rflg, key_index *idx) {
+	size_t i;
+	if ((out->used % 3) != 0) {
+		fprintf(stderr, "Find factors returned an invalid array\n");
+	} else if (jflg > 0) {
+		for(i = 0; i < out->used; i+=3) {
+			gmp_printf("{\"type\":\"result\",\"msg\":\"%s\",\"key\":\"%Zu\",\"p\":\"%Zu\",\"q\":\"%Zu\"", msg, out->array[i], out->array[i+1], out->array[i+2]);
+			print_indices(idx, out->array[i], jflg);
+			printf("}\n");
+		}
+		fflush(stdout);
+	} else if (rflg > 0) {
+		for(i = 0; i < out->used; i++)
+			mpz_out_raw(stdout, out->array[i]);
+	} else {
+		for(i = 0; i < out->used; i+=3) {
+			gmp_printf("\n### %s of\n%Zu\n=\n%Zu\nx\n%Zu\n", msg, out->array[i], out->array[i+1], out->array[i+2]);
+			print_indices(idx, out->array[i], jflg);
+		}
+	}
+}
+
+// Append the prime factors of the triples in `out` to the known primes
+// file. `known` has to be sorted, primes already in `known` are skipped.
+static size_t store_known(mpz_array *out, mpz_array *known, const char *filename) {
+	mpz_array found, uniques, primes;
+	size_t i, count;
+
+	array_init(&found, out->used);
+	for (i = 0; i + 2 < out->used; i+=3) {
+		array_add(&found, out->array[i+1]);
+		array_add(&found, out->array[i+2]);
+	}
+	array_msort(&found);
+	array_init(&uniques, found.used);
+	array_unique(&uniques, &found);
+
+	array_init(&primes, uniques.used);
+	for (i = 0; i < uniques.used; i++) {
+		if (!array_sorted_contains(known, uniques.array[i]) &&
+		mpz_probab_prime_p(uniques.array[i], 25) > 0)
+			array_add(&primes, uniques.array[i]);
+	}
+	count = primes.used > 0 ? array_to_file(&primes, filename) : 0;
+
+	array_clear(&found);
+	array_clear(&uniques);
+	array_clear(&primes);
+	return count;
+}
+
+// Print the memory used by GMP during a phase and start the next phase.
+static void print_memory(const char *phase, int jflg) {
+	memory_stats total, threads[MEMORY_MAX_THREADS];
+	long long depths[MEMORY_MAX_DEPTH];
+	size_t i, n, d;
+
+	memory_total(&total);
+	n = memory_threads(threads, MEMORY_MAX_THREADS);
+	d = memory_depths(depths, MEMORY_MAX_DEPTH);
+	if (jflg > 0) {
+		printf("{\"type\":\"memory\",\"phase\":\"%s\",\"current\":%lld,\"peak\":%lld,\"allocs\":%zu,\"reallocs\":%zu,\"frees\":%zu,\"arena\":%zu,\"threads\":[",
+			phase, total.current, total.peak, total.allocs, total.reallocs, total.frees, total.arena);
+		for (i = 0; i < n; i++)
+			printf("%s{\"current\":%lld,\"peak\":%lld,\"allocs\":%zu}", i ? "," : "",
+				threads[i].current, threads[i].peak, threads[i].allocs);
+		printf("],\"depths\":[");
+		for (i = 0; i < d; i++)
+			printf("%s%lld", i ? "," : "", depths[i]);
+		printf("],\"huge\":{\"mapped\":%lld,\"backed\":%lld}}\n",
+			memory_huge_mapped(), memory_huge_backed());
+		fflush(stdout);
+	} else {
+		printf("memory %s: current %lld, peak %lld bytes, %zu allocs (%zu from arenas), %zu reallocs, %zu frees\n",
+			phase, total.current, total.peak, total.allocs, total.arena, total.reallocs, total.frees);
+		for (i = 0; i < n; i++)
+			printf("  thread %zu: peak %lld bytes, %zu allocs\n", i, threads[i].peak, threads[i].allocs);
+		for (i = 0; d > 1 && i < d; i++)
+			printf("  cb depth %zu: peak %lld bytes\n", i, depths[i]);
+		if (memory_huge_mapped() > 0)
+			printf("  hugepages: %lld bytes mapped, %lld bytes backed\n",
+				memory_huge_mapped(), memory_huge_backed());
+	}
+	memory_reset();
+}
+
+// #### early results
+// Keys already reported as early result, their hash set and the output
+// format.
+static mpz_array early_keys;
+static mpz_hashset early_set;
+static int early_jflg = 0;
+static key_index *early_index = NULL;
+
+// Called by `cb` as soon as a subtree of the keys shares a factor. The
+// keys of this subtree which are not in its coprime base are factored over
+// it and printed right away, the global run continues.
+static void early_result(mpz_pool *pool, mpz_t *s, size_t from, size_t to, mpz_array *base) {
+	mpz_array out, changed;
+	mpz_hashset h;
+	size_t i;
+
+	array_init(&changed, 9);
+	hashset_init(&h, base, base->used);
+	for (i = 0; i < base->used; i++)
+		hashset_add(&h, i);
+	for (i = from; i <= to; i++) {
+		if (hashset_find(&h, s[i]) == HASHSET_NONE)
+			array_add(&changed, s[i]);
+	}
+	hashset_clear(&h);
+
+	array_init(&out, 9);
+	if (changed.used > 0)
+		array_find_factors(pool, &out, &changed, base);
+	array_clear(&changed);
+#if USE_OPENMP
+	#pragma omp critical (early_result)
+#endif
+	{
+		for (i = 0; i + 2 < out.used; i+=3) {
+			if (hashset_find(&early_set, out.array[i]) != HASHSET_NONE)
+				continue;
+			array_add(&early_keys, out.array[i]);
+			hashset_add(&early_set, early_keys.used - 1);
+			if (early_jflg > 0) {
+				gmp_printf("{\"type\":\"early result\",\"msg\":\"Found factors\",\"key\":\"%Zu\",\"p\":\"%Zu\",\"q\":\"%Zu\"", out.array[i], out.array[i+1], out.array[i+2]);
+				print_indices(early_index, out.array[i], early_jflg);
+				printf("}\n");
+			} else {
+				gmp_printf("\n### Found early factors of\n%Zu\n=\n%Zu\nx\n%Zu\n", out.array[i], out.array[i+1], out.array[i+2]);
+				print_indices(early_index, out.array[i], early_jflg);
+			}
+		}
+		fflush(stdout);
+	}
+	array_clear(&out);
+}
+
+// Count the keys which are not in the coprime base `p`. Only these keys
+// have a nontrivial factorization.
+static size_t count_changed(mpz_array *s, mpz_array *p) {
+	mpz_hashset h;
+	size_t i, n = 0;
+
+	hashset_init(&h, p, p->used);
+	for (i = 0; i < p->used; i++)
+		hashset_add(&h, i);
+	for (i = 0; i < s->used; i++) {
+		if (hashset_find(&h, s->array[i]) == HASHSET_NONE)
+			n++;
+	}
+	hashset_clear(&h);
+	return n;
+}
+
 // The generic `main` function.
 //
 // Define all variables at the beginning to make the C99 compiler
 // happy.
 int main(int argc, char **argv) {
-	mpz_array s, p, out;
+	mpz_array s, p, out, known, hits, g, rest, full, nonzero, *keys;
 	mpz_pool pool;
-	size_t count, i;
-	int c, vflg = 0, sflg = 0, rflg = 0, errflg = 0, jflg = 0, r = 0;
+	mpz_t x;
+	key_index index, *idx = NULL;
+	source_map sources;
+	size_t count, changed, i, j, *map = NULL, *order = NULL, *rank = NULL;
+	int c, vflg = 0, sflg = 0, rflg = 0, errflg = 0, jflg = 0, zflg = 0, pflg = 0, eflg = 0, lflg = 0, uflg = 0, r = 0;
 	char *filename = "primes.lst";
 	char *cb_file = NULL;
+	char *known_file = NULL;
+	char *source_file = NULL;
+	long int bucket_width = 0, arena_mb = 0, huge_mb = 0;
 
 	// #### argument parsing
 	// Boring `getopt` argument parsing.
-	while ((c = getopt(argc, argv, ":svrjb:")) != -1) {
+	while ((c = getopt(argc, argv, ":svrjzpelua:b:k:K:H:S:")) != -1) {
 		switch(c) {
 		case 'b':
 			cb_file = optarg;
@@ -62,6 +281,39 @@ int main(int argc, char **argv) {
 		case 'j':
 			jflg++;
 			break;
+		case 'z':
+			zflg++;
+			break;
+		case 'p':
+			pflg++;
+			break;
+		case 'e':
+			eflg++;
+			break;
+		case 'l':
+			lflg++;
+			break;
+		case 'u':
+			uflg++;
+			break;
+		case 'K':
+			known_file = optarg;
+			break;
+		case 'S':
+			source_file = optarg;
+			break;
+		case 'a':
+			arena_mb = strtol(optarg, NULL, 0);
+			if (arena_mb < 1) errflg++;
+			break;
+		case 'H':
+			huge_mb = strtol(optarg, NULL, 0);
+			if (huge_mb < 1) errflg++;
+			break;
+		case 'k':
+			bucket_width = strtol(optarg, NULL, 0);
+			if (bucket_width < 1) errflg++;
+			break;
 		case ':':
 			fprintf(stderr, "Option -%c requires an operand\n", optopt);
 			errflg++;
@@ -82,14 +334,29 @@ int main(int argc, char **argv) {
 		errflg++;
 	}
 
+	if (rflg && lflg) {
+		fprintf(stderr, "\n\t-r and -l can't be used simultaneously!\n\n");
+		errflg++;
+	}
+
 	// Print the usage and exit if an error occurred during argument parsing.
 	if (errflg) {
-		fprintf(stderr, "usage: [-vsr] [file]\n"\
+		fprintf(stderr, "usage: [-vsrzpelu] [file]\n"\
                         "\n\t-b FILE   store the coprime base in FILE"\
                         "\n\t-v        be more verbose"\
 						"\n\t-j        use json as output format"\
                         "\n\t-r        output the found coprimes in raw gmp format"\
                         "\n\t-s        only check if there are coprimes"\
+                        "\n\t-z        split the recursion by bit size instead of count"\
+                        "\n\t-p        presort the keys by size"\
+                        "\n\t-k BITS   compute the coprime base per key size bucket of BITS"\
+                        "\n\t-e        extract the factors of RSA moduli by remainder trees"\
+                        "\n\t-l        print the factors of subtrees as soon as cb finds them"\
+                        "\n\t-u        report the results for every occurrence of a duplicate key"\
+                        "\n\t-S FILE   report the csv offsets of the keys from the csv2gmp sidecar FILE, implies -u"\
+                        "\n\t-K FILE   screen the keys by the known primes in FILE and add new primes"\
+                        "\n\t-a MB     take the temporaries of cbmerge from thread-local arenas of MB"\
+                        "\n\t-H MB     map integers of at least MB on transparent hugepages"\
                         "\n\n");
 		exit(2);
 	}
@@ -110,6 +377,28 @@ int main(int argc, char **argv) {
 #endif
 	}
 
+	// Count the memory used by GMP. The allocation functions have to be
+	// installed before the first integer is initialized.
+	if (vflg > 0 || jflg > 0) {
+		memory_init();
+	}
+	if (arena_mb > 0) {
+		memory_arena_init((size_t)arena_mb << 20);
+	}
+	if (huge_mb > 0 && !memory_huge_init((size_t)huge_mb << 20)) {
+		fprintf(stderr, "WARNING: This build does not support hugepages!\n");
+	}
+
+	// The sidecar is looked up by the input indices of the keys.
+	if (source_file != NULL) {
+		if (!source_open(&sources, source_file)) {
+			fprintf(stderr, "Can't load %s\n", source_file);
+			return 1;
+		}
+		key_sources = &sources;
+		uflg++;
+	}
+
 	// Load the keys.
 	array_init(&s, 10);
 	count = array_of_file(&s, filename);
@@ -126,6 +415,46 @@ int main(int argc, char **argv) {
 		fprintf(stderr, "No primes loaded (empty file)\n");
 		return 3;
 	}
+	if (key_sources != NULL && sources.count != count) {
+		fprintf(stderr, "WARNING: %s has %zu offsets for %zu keys!\n", source_file, sources.count, count);
+	}
+	// Balance the recursion by bit size. Presorting the keys groups keys
+	// of equal size into the same subtrees.
+	if (zflg > 0) {
+		set_split_mode(SPLIT_BITS);
+	}
+	// Remove the duplicate keys by hash, they would show up as shared
+	// factors. With `-u` `map` keeps the unique key of every input index.
+	if (uflg > 0)
+		map = (size_t *)malloc(count * sizeof(size_t));
+	array_dedup(&s, map);
+	if (pflg > 0 && uflg > 0) {
+		order = (size_t *)malloc(s.used * sizeof(size_t));
+		rank = (size_t *)malloc(s.used * sizeof(size_t));
+		array_msort_index(&s, order);
+		// Move the unique keys of `map` along with the sorted keys.
+		for (i = 0; i < s.used; i++)
+			rank[order[i]] = i;
+		for (i = 0; i < count; i++)
+			map[i] = rank[map[i]];
+		free(order);
+		free(rank);
+	} else if (pflg > 0) {
+		array_msort(&s);
+	}
+	if (uflg > 0) {
+		keyindex_init(&index, &s, map, count);
+		idx = &index;
+		free(map);
+	}
+	if (vflg > 0 && jflg == 0 && (uflg > 0 || count > s.used)) {
+		printf("%zu duplicate keys removed\n", count - s.used);
+	}
+
+	if (memory_installed()) {
+		print_memory("load", jflg);
+	}
+
 	// Print the key count.
 	if (vflg > 0 && jflg == 0) {
 		printf("%zu public keys loaded\n", s.used);
@@ -136,11 +465,116 @@ int main(int argc, char **argv) {
 		printf("{\"type\":\"start\",\"msg\":\"Starting factorization\",\"count\":%zu}\n", s.used);
 		fflush(stdout);
 	}
+	if (idx != NULL) {
+		print_duplicates(idx, jflg, rflg);
+	}
+
+
+	// #### known primes
+	// The same weak primes show up again and again. Keys divided by a known
+	// prime are reported right away and replaced by their cofactor, so primes
+	// shared by the cofactor are still found by the coprime base.
+	array_init(&known, 10);
+	array_init(&hits, 9);
+	if (known_file != NULL && array_of_file(&known, known_file) > 0) {
+		array_msort(&known);
+		mpz_init(x);
+		array_prod(&pool, &known, x);
+
+		// There is no remainder modulo 0, a zero key is dropped before the
+		// keys are screened (`cb` would ignore it as well). The keys are only
+		// copied if there is one.
+		keys = &s;
+		for (i = 0; i < s.used && mpz_sgn(s.array[i]) != 0; i++);
+		if (i < s.used) {
+			array_init(&nonzero, s.used);
+			for (i = 0; i < s.used; i++) {
+				if (mpz_sgn(s.array[i]) != 0)
+					array_add(&nonzero, s.array[i]);
+			}
+			fprintf(stderr, "warning: %zu zero keys ignored\n", s.used - nonzero.used);
+			keys = &nonzero;
+		}
+		array_init(&g, keys->used);
+		if (keys->used > 0)
+			array_screen(&pool, &g, x, keys);
+
+		// Keys with only known factors are factored over the known primes
+		// at once, the product of the primes is computed only once.
+		array_init(&full, 9);
+		array_init(&rest, 9);
+		for (i = 0; i < keys->used; i++) {
+			if (mpz_cmp_ui(g.array[i], 1) != 0 && mpz_cmp(g.array[i], keys->array[i]) == 0)
+				array_add(&rest, keys->array[i]);
+		}
+		if (rest.used > 0)
+			array_find_factors(&pool, &full, &rest, &known);
+		array_clear(&rest);
+
+		array_init(&rest, keys->used);
+		for (i = 0, j = 0; i < keys->used; i++) {
+			if (mpz_cmp_ui(g.array[i], 1) == 0) {
+				array_add(&rest, keys->array[i]);
+			} else if (mpz_cmp(g.array[i], keys->array[i]) == 0) {
+				// All factors are known, take the triples of this key.
+				for (; j + 2 < full.used && mpz_cmp(full.array[j], keys->array[i]) == 0; j += 3) {
+					array_add(&hits, full.array[j]);
+					array_add(&hits, full.array[j+1]);
+					array_add(&hits, full.array[j+2]);
+				}
+			} else {
+				mpz_fdiv_q(x, keys->array[i], g.array[i]);
+				array_add(&hits, keys->array[i]);
+				array_add(&hits, g.array[i]);
+				array_add(&hits, x);
+				array_add(&rest, x);
+			}
+		}
+		if (keys != &s)
+			array_clear(&nonzero);
+		if (vflg > 0 && jflg == 0) {
+			printf("%zu keys are divided by %zu known primes\n", hits.used / 3, known.used);
+		}
+		print_factors(&hits, "Found known factors", jflg, rflg, idx);
+
+		// The index still refers to the loaded keys.
+		if (uflg == 0)
+			array_clear(&s);
+		s = rest;
+		array_clear(&g);
+		array_clear(&full);
+		mpz_clear(x);
+		if (memory_installed()) {
+			print_memory("known", jflg);
+		}
+	}
 
+	// Report shared factors of subtrees while `cb` is still running.
+	if (lflg > 0) {
+		array_init(&early_keys, 9);
+		hashset_init(&early_set, &early_keys, 9);
+		early_jflg = jflg;
+		early_index = idx;
+		set_cb_found(early_result);
+	}
 
 	// Computing a coprime base for a finite set [Algorithm 18.1](copri.html#computing-a-coprime-base-for-a-finite-set).
+	// Mixed key sizes can be put into buckets first (see [array_cb_buckets](copri.html#computing-a-coprime-base-for-integers-of-mixed-sizes)).
 	array_init(&p, s.used);
-	array_cb(&pool, &p, &s);
+	if (s.used > 0 && bucket_width > 0) {
+		array_cb_buckets(&pool, &p, &s, bucket_width);
+	} else if (s.used > 0) {
+		array_cb(&pool, &p, &s);
+	}
+
+	if (lflg > 0) {
+		set_cb_found(NULL);
+		hashset_clear(&early_set);
+		array_clear(&early_keys);
+	}
+	if (memory_installed()) {
+		print_memory("cb", jflg);
+	}
 
 	if (cb_file != NULL) {
 		if (vflg > 0) {
@@ -156,8 +590,10 @@ int main(int argc, char **argv) {
 	}
 
 
-	// Check if we have found more coprime bases.
-	if (p.used == s.used) {
+	// Check if we have found more coprime bases. These are the keys which
+	// are not in the coprime base anymore.
+	changed = count_changed(&s, &p);
+	if (changed == 0) {
 		if (vflg > 0) {
 			if (jflg == 0) {
 				printf("No coprime pairs found :-(\n");
@@ -169,10 +605,10 @@ int main(int argc, char **argv) {
 		r = 0;
 	} else {
 		if (vflg > 0 && jflg == 0) {
-			printf("Found ~%zu coprime pairs!!!\n", (p.used - s.used));
+			printf("Found ~%zu coprime pairs!!!\n", changed);
 		}
 		if (jflg > 0) {
-			printf("{\"type\":\"interim result\",\"msg\":\"Found coprime pairs\",\"count\":%zu}\n", (p.used - s.used));
+			printf("{\"type\":\"interim result\",\"msg\":\"Found coprime pairs\",\"count\":%zu}\n", changed);
 			fflush(stdout);
 		}
 
@@ -187,30 +623,48 @@ int main(int argc, char **argv) {
 			}
 			array_init(&out, 9);
 			// Use [Algorithm 21.2](copri.html#factoring-a-set-over-a-coprime-base) to find the coprimes in the coprime base.
-			array_find_factors(&pool, &out, &s, &p);
+			// RSA moduli only need the element of the coprime base which divides them ([rsa_find_factors](copri.html#factoring-rsa-moduli-over-a-coprime-base)).
+			if (eflg > 0) {
+				array_rsa_find_factors(&pool, &out, &s, &p);
+			} else {
+				array_find_factors(&pool, &out, &s, &p);
+			}
 
 			// Output the factors.
 			if (out.used > 0) {
-				if ((out.used % 3) != 0) {
-					fprintf(stderr, "Find factors returned an invalid array\n");
-				} else {
-					if (jflg > 0) {
-						for(i = 0; i < out.used; i+=3)
-							gmp_printf("{\"type\":\"result\",\"msg\":\"Found factors\",\"key\":\"%Zu\",\"p\":\"%Zu\",\"q\":\"%Zu\"}\n", out.array[i], out.array[i+1], out.array[i+2]);
-					} else if (rflg > 0) {
-						for(i = 0; i < out.used; i++)
-							mpz_out_raw(stdout, out.array[i]);
-					} else {
-						for(i = 0; i < out.used; i+=3)
-							gmp_printf("\n### Found factors of\n%Zu\n=\n%Zu\nx\n%Zu\n", out.array[i], out.array[i+1], out.array[i+2]);
-					}
-				}
+				print_factors(&out, "Found factors", jflg, rflg, idx);
 			}
+			array_add_array(&hits, &out);
 			array_clear(&out);
+			if (memory_installed()) {
+				print_memory("factors", jflg);
+			}
+		}
+	}
+
+	// Remember the new primes.
+	if (known_file != NULL && hits.used > 0) {
+		count = store_known(&hits, &known, known_file);
+		if (vflg > 0) {
+			if (jflg == 0) {
+				printf("%zu new primes stored in '%s'\n", count, known_file);
+			} else {
+				printf("{\"type\":\"store\",\"msg\":\"Storing known primes\",\"file\":\"%s\",\"count\":%zu}\n", known_file, count);
+				fflush(stdout);
+			}
 		}
 	}
 
+	array_clear(&known);
+	array_clear(&hits);
 	array_clear(&p);
+	if (uflg > 0) {
+		if (index.keys.array != s.array)
+			array_clear(&index.keys);
+		keyindex_clear(&index);
+	}
+	if (key_sources != NULL)
+		source_close(&sources);
 	array_clear(&s);
 	if (vflg > 0 && jflg == 0)
 		pool_inspect(&pool);
@@ -0,0 +1,97 @@
+// copri, Attacking RSA by factoring coprimes
+//
+// License: GNU Lesser General Public License (LGPL), version 3 or later
+// See the lgpl.txt file in the root directory or <https://www.gnu.org/licenses/lgpl>.
+
+// This file contains a tool to build the [index sidecar](fileindex.html)
+// of raw GMP files.
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <gmp.h>
+#include "fileindex.h"
+
+// The generic `main` function.
+//
+// Define all variables at the beginning to make the C99 compiler
+// happy.
+int main(int argc, char **argv) {
+	file_index x;
+	mpz_array a;
+	size_t count, i;
+	int c, vflg = 0, pflg = 0, errflg = 0, r = 0;
+	long int seek = 0, length = 1;
+
+	// #### argument parsing
+	// Boring `getopt` argument parsing.
+	while ((c = getopt(argc, argv, ":vpb:l:")) != -1) {
+		switch(c) {
+		case 'v':
+			vflg++;
+			break;
+		case 'p':
+			pflg++;
+			break;
+		case 'b':
+			seek = strtol(optarg, NULL, 0);
+			if (seek < 0) errflg++;
+			break;
+		case 'l':
+			length = strtol(optarg, NULL, 0);
+			if (length < 1) errflg++;
+			break;
+		case ':':
+			fprintf(stderr, "Option -%c requires an operand\n", optopt);
+			errflg++;
+			break;
+		case '?':
+			fprintf(stderr, "Unrecognized option: '-%c'\n", optopt);
+			errflg++;
+		}
+	}
+
+	if (optind >= argc) {
+		errflg++;
+	}
+
+	// Print the usage and exit if an error occurred during argument parsing.
+	if (errflg) {
+		fprintf(stderr, "usage: [-v] [-p [-b INDEX] [-l COUNT]] file...\n"\
+						"\n\tbuild the index sidecar file" FILEINDEX_SUFFIX " of every file"\
+						"\n"\
+						"\n\t-p        print integers by the existing index instead"\
+						"\n\t-b INDEX  the first integer to print"\
+						"\n\t-l COUNT  the number of integers to print"\
+						"\n\t-v        be more verbose"\
+						"\n\n");
+		exit(2);
+	}
+
+	for (; optind < argc; optind++) {
+		// Print a range of integers by the index.
+		if (pflg > 0) {
+			if (!fileindex_open(&x, argv[optind])) {
+				fprintf(stderr, "Can't open the index of %s\n", argv[optind]);
+				r = 1;
+				continue;
+			}
+			array_init(&a, length);
+			count = fileindex_read(&x, &a, seek, length);
+			for (i = 0; i < count; i++)
+				gmp_printf("%Zd\n", a.array[i]);
+			array_clear(&a);
+			fileindex_close(&x);
+			continue;
+		}
+
+		count = fileindex_build(argv[optind]);
+		if (count == 0) {
+			fprintf(stderr, "Can't index %s\n", argv[optind]);
+			r = 1;
+		} else if (vflg > 0) {
+			printf("indexed %zu integers of '%s'\n", count, argv[optind]);
+		}
+	}
+
+	return r;
+}
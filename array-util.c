@@ -7,18 +7,73 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <unistd.h>
+#include <string.h>
 #include <gmp.h>
 #include "copri.h"
+#include "extsort.h"
+#include "sample.h"
+#include "fileindex.h"
+#include "stats.h"
+
+// At most this many rows of the bit size histogram are printed, wider
+// histograms are printed in buckets.
+#define MAX_HISTOGRAM_ROWS 32
+
+// Print the statistics of `-i`.
+static void print_stats(stream_stats *st, unsigned long bound) {
+	size_t bits, last, width = 1, n, sum, distinct = 0;
+	double unique;
+
+	printf("count: %zu\n", st->count);
+	if (st->count == 0)
+		return;
+	if (st->min_bits == st->max_bits) {
+		printf("size (all): %zu bit\n", st->min_bits);
+	} else {
+		printf("size:\n  - min: %zu bit\n  - max: %zu bit\n  - avg: %llu bit\n", st->min_bits, st->max_bits,
+			(st->sum_bits + st->count - 1) / st->count);
+	}
+
+	// Print the bit sizes, or buckets of a power of two bit sizes if
+	// there are too many.
+	for (bits = st->min_bits; bits <= st->max_bits; bits++) {
+		if (st->histogram[bits] > 0)
+			distinct++;
+	}
+	if (distinct > MAX_HISTOGRAM_ROWS) {
+		while ((st->max_bits - st->min_bits) / width >= MAX_HISTOGRAM_ROWS)
+			width *= 2;
+	}
+	if (distinct > 1) {
+		printf("histogram:\n");
+		for (bits = st->min_bits - st->min_bits % width; bits <= st->max_bits; bits += width) {
+			last = bits + width - 1;
+			for (n = bits, sum = 0; n <= last && n <= st->max_bits; n++)
+				sum += st->histogram[n];
+			if (sum == 0)
+				continue;
+			if (width == 1)
+				printf("  - %zu bit: %zu (%.2f%%)\n", bits, sum, 100.0 * sum / st->count);
+			else
+				printf("  - %zu-%zu bit: %zu (%.2f%%)\n", bits, last, sum, 100.0 * sum / st->count);
+		}
+	}
+
+	unique = stats_unique(st);
+	printf("unique (estimate): ~%.0f\n", unique < st->count ? unique : (double)st->count);
+	printf("small factors (< %lu): %zu (%.2f%%)\n", bound, st->small, 100.0 * st->small / st->count);
+	if (st->negative > 0)
+		printf("negative: %zu\n", st->negative);
+}
 
 // The generic `main` function.
 //
 // Define all variables at the beginning to make the C99 compiler
 // happy.
 int main(int argc, char **argv) {
-	mpz_array s, uniques, filtered, seekedLength, sample;
-	mpz_t sum_bits, avg;
-	size_t count, i, j, size, size_min = 0, size_max = 0;
-	int c, vflg = 0, iflg = 0, sflg = 0, lflg = 0, bflg = 0, rflg = 0, uflg = 0, tflg = 0, xflg = 0, jflg = 0, errflg = 0, r = 0;
+	mpz_array s, uniques, filtered, seekedLength;
+	size_t count, i, j, size;
+	int c, vflg = 0, iflg = 0, sflg = 0, lflg = 0, bflg = 0, rflg = 0, uflg = 0, tflg = 0, xflg = 0, jflg = 0, mflg = 0, errflg = 0, r = 0;
 	char *filename = "primes.lst";
 	char *out_filename = NULL;
 	long int length = 0;
@@ -27,15 +82,21 @@ int main(int argc, char **argv) {
 	long int bitsize = 0;
 	// for random sampling
 	long int sample_size = 0;
+	long int strata_width = 0;
 	gmp_randstate_t randstate;
-	mpz_t r_index;
-	mpz_t r_max;
-	size_t *used_indices;
-	int found = 0;
+	// for the external sort
+	long int budget_mb = 0;
+	FILE *in, *out;
+	// for the index sidecar
+	file_index index;
+	int ranged = 0;
+	// for the statistics
+	stream_stats stats;
+	unsigned long bound = STATS_SMALL_BOUND;
 
 	// #### argument parsing
 	// Boring `getopt` argument parsing.
-	while ((c = getopt(argc, argv, ":vsiujr:x:t:b:l:o:")) != -1) {
+	while ((c = getopt(argc, argv, ":vsiujm:r:k:x:t:b:l:o:p:")) != -1) {
 		switch(c) {
 		case 'o':
 			out_filename = optarg;
@@ -55,10 +116,23 @@ int main(int argc, char **argv) {
 		case 'j':
 			jflg++;
 			break;
+		case 'm':
+			mflg++;
+			budget_mb = strtol(optarg, NULL, 0);
+			if (budget_mb < 1) errflg++;
+			break;
 		case 'r':
 			rflg++;
 			sample_size = strtol(optarg, NULL, 0);
 			break;
+		case 'p':
+			bound = strtoul(optarg, NULL, 0);
+			if (bound < 3) errflg++;
+			break;
+		case 'k':
+			strata_width = strtol(optarg, NULL, 0);
+			if (strata_width < 1) errflg++;
+			break;
 		case 'x':
 			xflg++;
 			bitsize = strtol(optarg, NULL, 0);
@@ -96,17 +170,25 @@ int main(int argc, char **argv) {
 		errflg++;
 	}
 
+	if (mflg > 0 && (sflg + uflg == 0 || iflg + jflg + rflg + xflg + lflg + bflg > 0)) {
+		fprintf(stderr, "\n\t-m only works with -s and -u!\n\n");
+		errflg++;
+	}
+
 	// Print the usage and exit if an error occurred during argument parsing.
 	if (errflg) {
 		fprintf(stderr, "usage: [-vs] [-o FILE] [file]\n"\
 						"\n\t-i        inspect the array"\
+						"\n\t-p BOUND  count the integers with a prime factor below BOUND for -i (default 1000)"\
 						"\n\t-o FILE   the output file"\
 						"\n\t-l length max values to output or chunk size"\
 						"\n\t-b count  skip first count (seek)"\
 						"\n\t-r length create random sample"\
+						"\n\t-k bits   stratify the random sample by size buckets of bits"\
 						"\n\t-v        be more verbose"\
 						"\n\t-s        sort the input"\
 						"\n\t-u        count uniques"\
+						"\n\t-m MB     sort (-s) and drop duplicates (-u) in runs of MB spilled to $TMPDIR"\
 						"\n\t-j        print json array"\
 						"\n\t-x bits   only output integers with size bits"\
 						"\n\t-t bits   tolerance in bits for -x"\
@@ -114,14 +196,114 @@ int main(int argc, char **argv) {
 		exit(2);
 	}
 
+	// #### external sort
+	// The integers are not loaded, but streamed through sorted runs of at
+	// most `budget_mb` MB in temporary files (see [extsort](extsort.html)).
+	if (mflg > 0) {
+		in = strcmp(filename, "-") == 0 ? stdin : fopen(filename, "r");
+		if (in == NULL) {
+			fprintf(stderr, "Can't load %s\n", filename);
+			return 1;
+		}
+		out = NULL;
+		if (out_filename != NULL) {
+			if (vflg > 0)
+				printf("storing output in '%s'\n", out_filename);
+			out = strcmp(out_filename, "-") == 0 ? stdout : fopen(out_filename, "a+");
+		}
+		if (vflg > 0)
+			printf("sorting the input integers in runs of %ld MB...\n", budget_mb);
+		count = array_extsort(in, out, (size_t)budget_mb << 20, uflg > 0, &i);
+		if (i == 0) {
+			fprintf(stderr, "No integers loaded (empty file)\n");
+			r = 3;
+		} else if (count == 0) {
+			fprintf(stderr, "External sort failed\n");
+			r = 4;
+		} else if (uflg > 0) {
+			printf("unique: %zu / %zu\n", count, i);
+		}
+		if (in != stdin)
+			fclose(in);
+		if (out != NULL && out != stdout)
+			fclose(out);
+		return r;
+	}
+
 	// Default to inspect.
 	if (!sflg && !jflg && !rflg) {
 		iflg++;
 	}
 
-	// Load the integers.
+	// #### streaming statistics
+	// Only inspecting the input needs no array, the statistics are computed
+	// while reading in constant memory (see [stats](stats.html)).
+	if (iflg > 0 && !sflg && !uflg && !rflg && !xflg && !lflg && !bflg && !jflg && out_filename == NULL) {
+		in = strcmp(filename, "-") == 0 ? stdin : fopen(filename, "r");
+		if (in == NULL) {
+			fprintf(stderr, "Can't load %s\n", filename);
+			return 1;
+		}
+		stats_init(&stats, bound);
+		count = array_stats_stdio(&stats, in);
+		if (in != stdin)
+			fclose(in);
+		if (count == 0) {
+			fprintf(stderr, "No integers loaded (empty file)\n");
+			stats_clear(&stats);
+			return 3;
+		}
+		print_stats(&stats, bound);
+		stats_clear(&stats);
+		return 0;
+	}
+
+	// Load the integers. A random sample is drawn while the input is read
+	// (see [sample](sample.html)), only the sample is kept in memory.
 	array_init(&s, 10);
-	count = array_of_file(&s, filename);
+	if (rflg > 0) {
+		if (sample_size <= 0) {
+			fprintf(stderr, "Sample size is %ld\n", sample_size);
+			return 6;
+		}
+		in = strcmp(filename, "-") == 0 ? stdin : fopen(filename, "r");
+		if (in == NULL) {
+			fprintf(stderr, "Can't load %s\n", filename);
+			return 1;
+		}
+		if (vflg > 0) {
+			printf("creating random sample of %ld integers\n", sample_size);
+		}
+		gmp_randinit_default(randstate);
+		count = array_sample_stdio(&s, in, sample_size, strata_width,
+			xflg > 0 && bitsize > tolerance ? bitsize - tolerance : 0,
+			xflg > 0 ? bitsize + tolerance : 0, randstate, &i);
+		gmp_randclear(randstate);
+		if (in != stdin)
+			fclose(in);
+		if (count < (size_t)sample_size) {
+			fprintf(stderr, "Sample size %ld is bigger then input size %zu\n", sample_size, i);
+			return 6;
+		}
+		if (vflg > 0) {
+			printf("picked %zu of %zu random integers\n", count, i);
+		}
+	} else if ((lflg || bflg) && !sflg && !uflg && !xflg && fileindex_open(&index, filename)) {
+		// Seek and limit by the index sidecar, the other integers are not
+		// read (see [fileindex](fileindex.html)).
+		if (vflg > 0) {
+			printf("seeking to %zu and limiting to %zu integers by the index\n", seek, length);
+		}
+		count = fileindex_read(&index, &s, seek, lflg ? (size_t)length : index.count);
+		if (count == 0 && seek >= 0 && (size_t)seek >= index.count) {
+			fprintf(stderr, "Seek %ld is behind the %zu integers of %s\n", seek, index.count, filename);
+			return 1;
+		}
+		fileindex_close(&index);
+		ranged = 1;
+	} else {
+		count = array_of_file(&s, filename);
+	}
 	if (count == 0) {
 		fprintf(stderr, "Can't load %s\n", filename);
 		return 1;
@@ -149,8 +331,8 @@ int main(int argc, char **argv) {
 
 	// # filter functions
 
-	// filter per bit size
-	if (xflg > 0) {
+	// filter per bit size, the sample is filtered while drawing
+	if (xflg > 0 && rflg == 0) {
 		if (vflg > 0) {
 			printf("filter %zu integers by size %zu bits +/- %zu bits\n", s.used, bitsize, tolerance);
 		}
@@ -165,52 +347,8 @@ int main(int argc, char **argv) {
 		s = filtered;
 	}
 
-	// create random sample
-	if (rflg > 0) {
-		if (s.used < sample_size) {
-			fprintf(stderr, "Sample size %zu is bigger then input size %zu\n", sample_size, s.used);
-			return 6;
-		}
-		if (sample_size <= 0) {
-			fprintf(stderr, "Sample size is %zu\n", sample_size);
-			return 6;
-		}
-		if (vflg > 0) {
-			printf("creating random sample of %zu from %zu integers\n", sample_size, s.used);
-		}
-		gmp_randinit_default(randstate);
-		mpz_init_set_ui(r_max, s.used);
-		mpz_init(r_index);
-		array_init(&sample, 10);
-		used_indices = (size_t *)malloc(sample_size * sizeof(size_t));
-		while(sample.used < sample_size) {
-			mpz_urandomm(r_index, randstate, r_max);
-			i = mpz_get_ui(r_index);
-			found = 0;
-			for (j=0; j<sample.used; j++) {
-				if (used_indices[j] == i) {
-					found = 1;
-					break;
-				}
-			}
-			if (!found) {
-				used_indices[sample.used] = i;
-				array_add(&sample, s.array[i]);
-				if (vflg > 0 && (sample.used % (sample_size / 10) == 0 || sample.used == sample_size)) {
-					printf("picked %zu of %zu random integers\n", sample.used, sample_size);
-				}
-			}
-		}
-		free(used_indices);
-		gmp_randclear(randstate);
-		mpz_clear(r_index);
-		mpz_clear(r_max);
-		array_clear(&s);
-		s = sample;
-	}
-
 	// filter per seek and length
-	if (lflg || bflg) {
+	if ((lflg || bflg) && !ranged) {
 		if (vflg > 0) {
 			printf("seeking to %zu and limiting to %zu integers\n", seek, length);
 		}
@@ -231,28 +369,10 @@ int main(int argc, char **argv) {
 
 	// print info
 	if (iflg > 0) {
-		printf("count: %zu\n", s.used);
-		mpz_init_set_ui(sum_bits, 0);
-		for(i=0; i<s.used; i++) {
-			size = mpz_sizeinbase(s.array[i], 2);
-			mpz_add_ui(sum_bits, sum_bits, size);
-			if (size_min == 0 || size_min > size)
-				size_min = size;
-			if (size_max == 0 || size_max < size)
-				size_max = size;
-
-		}
-		mpz_init(avg);
-		mpz_cdiv_q_ui(avg, sum_bits, s.used);
-
-		if (size_min == size_max) {
-			printf("size (all): %zu bit\n", size_min);
-		} else {
-			gmp_printf("size:\n  - min: %zu bit\n  - max: %zu bit\n  - avg: %Zu bit\n", size_min, size_max, avg);
-		}
-		mpz_clear(avg);
-		mpz_clear(sum_bits);
-
+		stats_init(&stats, bound);
+		array_stats(&stats, &s);
+		print_stats(&stats, bound);
+		stats_clear(&stats);
 	}
 
 	// print JSON
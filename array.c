@@ -10,6 +10,9 @@
 #include <gmp.h>
 #include "array.h"
 #include "config.h"
+#if USE_OPENMP
+#include <omp.h>
+#endif
 
 #define MIN(a,b) (((a)<(b))?(a):(b))
 #define MAX(a,b) (((a)>(b))?(a):(b))
@@ -136,6 +139,20 @@ size_t array_of_stdio(mpz_array *a, FILE *in) {
 	return count;
 }
 
+// Reads at most `max` values from stream `in` into the array. Returns the
+// count, which is less than `max` at the end of the stream. Large files
+// can be processed in blocks this way.
+size_t array_read_stdio(mpz_array *a, FILE *in, size_t max) {
+	size_t count = 0;
+	mpz_t buf;
+	mpz_init(buf);
+	while(count < max && mpz_inp_raw(buf, in) > 0) {
+		array_add(a, buf);
+		count++;
+	}
+	mpz_clear(buf);
+	return count;
+}
 
 // Populates an array with values read from a file.
 size_t array_of_file(mpz_array *a, const char *filename) {
@@ -182,63 +199,153 @@ size_t array_to_file(mpz_array *a, const char *filename) {
 
 // ## sort a array
 
-// merge two sorted lists
-void array_msort_merge(mpz_array *a, size_t iLeft,
-size_t iRight, size_t iEnd, mpz_array *b) {
-	int i0 = iLeft;
-	int i1 = iRight;
-	int j;
-
-	// While there are elements in the left or right lists
-	for (j = iLeft; j < iEnd; j++) {
-		// If left list head exists and is <= existing right list head
-		if (i0 < iRight && (i1 >= iEnd || mpz_cmp(
-			a->array[i0],
-			a->array[i1]
-		) <= 0)) {
-			mpz_set(b->array[j], a->array[i0]);
-			i0 = i0 + 1;
+// The integers are not moved while sorting. A key of (signed bit length,
+// top 64 bits) is sorted for every integer and `mpz_cmp` is only called if
+// both are equal. Negative integers get a negative bit length and an
+// inverted prefix, so the keys are in the same order as the integers.
+typedef struct {
+	long long bits;
+	unsigned long long prefix;
+	const __mpz_struct *ptr;
+} sort_key;
+
+// Below this size the keys are sorted by a single thread.
+#define SORT_PARALLEL_SIZE 16384
+
+static void sort_key_init(sort_key *k, const __mpz_struct *x) {
+	size_t n = mpz_size(x);
+	unsigned long long hi, lo;
+	int lz;
+
+	k->ptr = x;
+	k->bits = 0;
+	k->prefix = 0;
+	if (n == 0) return;
+
+	k->bits = (long long)mpz_sizeinbase(x, 2);
+	hi = mpz_getlimbn(x, n - 1);
+	lo = n > 1 ? mpz_getlimbn(x, n - 2) : 0;
+#if GMP_NUMB_BITS == 64
+	// Shift the leading one to the top.
+	lz = (int)(n * 64 - (size_t)k->bits);
+	k->prefix = lz ? (hi << lz) | (lo >> (64 - lz)) : hi;
+#else
+	// Integers of the same bit length have the same alignment.
+	(void)lz;
+	k->prefix = (hi << GMP_NUMB_BITS) | lo;
+#endif
+	if (mpz_sgn(x) < 0) {
+		k->bits = -k->bits;
+		k->prefix = ~k->prefix;
+	}
+}
+
+static int sort_key_cmp(const void *a, const void *b) {
+	const sort_key *x = (const sort_key *)a, *y = (const sort_key *)b;
+	if (x->bits != y->bits) return x->bits < y->bits ? -1 : 1;
+	if (x->prefix != y->prefix) return x->prefix < y->prefix ? -1 : 1;
+	return mpz_cmp(x->ptr, y->ptr);
+}
+
+// Merge the sorted runs `a[from:mid]` and `a[mid:to]` into `b[from:to]`.
+static void sort_key_merge(sort_key *a, sort_key *b, size_t from,
+size_t mid, size_t to) {
+	size_t i0 = from, i1 = mid, j;
+
+	for (j = from; j < to; j++) {
+		if (i0 < mid && (i1 >= to || sort_key_cmp(&a[i0], &a[i1]) <= 0)) {
+			b[j] = a[i0++];
 		} else {
-			mpz_set(b->array[j], a->array[i1]);
-			i1 = i1 + 1;
+			b[j] = a[i1++];
 		}
 	}
 }
 
-// Sort the array by [merge sort](http://en.wikipedia.org/wiki/Merge_sort)
+// Sort the array. The keys are sorted in chunks by `qsort`, one chunk per
+// thread, and the chunks are merged pairwise in parallel. At the end the
+// permutation is applied by swapping the integers along its cycles, so no
+// integer is copied.
 void array_msort(mpz_array *a) {
-	size_t width, i, n = a->used;
-	mpz_array b;
-
-	// Prepare the working array B.
-	array_init(&b, n);
-	b.used = n;
-	for (i=0; i<n; i++) {
-		mpz_init(b.array[i]);
+	array_msort_index(a, NULL);
+}
+
+// Sort the array like `array_msort`. If `order` is not `NULL`, `order[i]`
+// is set to the old index of the integer at the new index `i`.
+void array_msort_index(mpz_array *a, size_t *order) {
+	size_t n = a->used, chunks = 1, width, i, j, k;
+	size_t *perm;
+	sort_key *keys, *buf, *t;
+
+	if (order != NULL && n == 1) order[0] = 0;
+	if (n < 2) return;
+
+	keys = (sort_key *)malloc(n * sizeof(sort_key));
+	buf = (sort_key *)malloc(n * sizeof(sort_key));
+	perm = (size_t *)malloc(n * sizeof(size_t));
+	if (keys == NULL || buf == NULL || perm == NULL) {
+		fprintf(stderr, "Can't allocate the sort keys of %zu integers\n", n);
+		free(keys);
+		free(buf);
+		free(perm);
+		for (i = 0; order != NULL && i < n; i++)
+			order[i] = i;
+		return;
+	}
+
+#if USE_OPENMP
+	if (n >= SORT_PARALLEL_SIZE) {
+		chunks = omp_get_max_threads();
+		if (chunks > n / (SORT_PARALLEL_SIZE / 4))
+			chunks = n / (SORT_PARALLEL_SIZE / 4);
+	}
+	#pragma omp parallel for schedule(static)
+#endif
+	for (i = 0; i < n; i++) {
+		sort_key_init(&keys[i], a->array[i]);
+	}
+
+	// Sort the chunks.
+	width = (n + chunks - 1) / chunks;
+#if USE_OPENMP
+	#pragma omp parallel for schedule(static)
+#endif
+	for (i = 0; i < chunks; i++) {
+		if (i * width < n)
+			qsort(&keys[i * width], MIN(width, n - i * width), sizeof(sort_key), sort_key_cmp);
 	}
 
-	// Each 1-element run in A is already *sorted*.
-	// Make successively longer sorted runs of length 2, 4, 8, 16... until whole array is sorted.
-	for (width = 1; width < n; width = 2 * width) {
-		// Array A is full of runs of length width.
-		for (i = 0; i < n; i = i + 2 * width) {
-			// Merge two runs: A[i:i+width-1] and A[i+width:i+2*width-1] to B[]
-			// or copy A[i:n-1] to B[] ( if(i+width >= n) )
-			array_msort_merge(
-				a,
-				i,
-				MIN(i+width, n),
-				MIN(i+2*width, n),
-				&b
-			);
+	// Merge successively longer runs.
+	for (; width < n; width = 2 * width) {
+#if USE_OPENMP
+		#pragma omp parallel for schedule(static)
+#endif
+		for (i = 0; i < (n + 2 * width - 1) / (2 * width); i++) {
+			sort_key_merge(keys, buf, i * 2 * width,
+				MIN(i * 2 * width + width, n), MIN(i * 2 * width + 2 * width, n));
 		}
+		t = keys;
+		keys = buf;
+		buf = t;
+	}
 
-		// Now work array B is full of runs of length 2*width.
-		// Swap array B to array A for next iteration.
-		array_swap(a, &b);
-		// Now array A is full of runs of length 2*width.
+	// Apply the permutation: position i gets the integer at perm[i].
+	for (i = 0; i < n; i++) {
+		perm[i] = (size_t)(keys[i].ptr - a->array[0]);
+		if (order != NULL) order[i] = perm[i];
+	}
+	for (i = 0; i < n; i++) {
+		j = i;
+		while ((k = perm[j]) != i) {
+			mpz_swap(a->array[j], a->array[k]);
+			perm[j] = j;
+			j = k;
+		}
+		perm[j] = j;
 	}
-	array_clear(&b);
+
+	free(keys);
+	free(buf);
+	free(perm);
 }
 
 // Test if the array contains the integer.
@@ -251,6 +358,23 @@ int array_contains(mpz_array *a, const mpz_t integer) {
 	return 0;
 }
 
+// Test if the sorted array contains the integer by binary search.
+int array_sorted_contains(mpz_array *sorted, const mpz_t integer) {
+	size_t lo = 0, hi = sorted->used, mid;
+	int c;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		c = mpz_cmp(sorted->array[mid], integer);
+		if (c == 0)
+			return 1;
+		if (c < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return 0;
+}
+
 // Returns an sorted array with unique values.
 // This function expects an sorted array as input.
 void array_unique(mpz_array *uniques, mpz_array *sorted) {
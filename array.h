@@ -6,6 +6,8 @@
 #ifndef ARRAY_H
 #define ARRAY_H
 
+#include <stdio.h>
+
 typedef struct {
 	mpz_t * array;
 	size_t used;
@@ -32,10 +34,16 @@ size_t array_of_file(mpz_array *a, const char *filename);
 
 size_t array_to_file(mpz_array *a, const char *filename);
 
+size_t array_read_stdio(mpz_array *a, FILE *in, size_t max);
+
 void array_msort(mpz_array *a);
 
+void array_msort_index(mpz_array *a, size_t *order);
+
 int array_contains(mpz_array *a, const mpz_t integer);
 
+int array_sorted_contains(mpz_array *sorted, const mpz_t integer);
+
 void array_unique(mpz_array *uniques, mpz_array *sorted);
 
 #endif /* ARRAY_H */
@@ -7,8 +7,12 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <unistd.h>
+#include <string.h>
 #include <gmp.h>
 #include "copri.h"
+#include "hash.h"
+#include "extsort.h"
+#include "fileindex.h"
 
 #define MAX_CHUNK_NAME_LENGTH 256
 
@@ -17,20 +21,24 @@
 // Define all variables at the beginning to make the C99 compiler
 // happy.
 int main(int argc, char **argv) {
-	mpz_array s, uniques, o;
+	mpz_array s, o;
 	size_t count, chunk_count = 2, length, j, wc;
-	int c, vflg = 0, lflg = 0, nflg = 0, errflg = 0, r = 0;
+	int c, vflg = 0, lflg = 0, nflg = 0, mflg = 0, errflg = 0, r = 0;
 	char *filename = "primes.lst";
 	char *out_filename = NULL;
 	char chunk_name[MAX_CHUNK_NAME_LENGTH];
 	long int level = 0, i, chunk_size_ui, index;
 	unsigned int padding = 9;
+	long int budget_mb = 0;
+	FILE *in, *sorted = NULL;
+	file_index fidx;
+	int indexed = 0;
 
 	mpf_set_default_prec(64);
 
 	// #### argument parsing
 	// Boring `getopt` argument parsing.
-	while ((c = getopt(argc, argv, ":vnl:o:")) != -1) {
+	while ((c = getopt(argc, argv, ":vnm:l:o:")) != -1) {
 		switch(c) {
 		case 'o':
 			out_filename = optarg;
@@ -41,6 +49,11 @@ int main(int argc, char **argv) {
 		case 'v':
 			vflg++;
 			break;
+		case 'm':
+			mflg++;
+			budget_mb = strtol(optarg, NULL, 0);
+			if (budget_mb < 1) errflg++;
+			break;
 		case 'l':
 			lflg++;
 			level = strtol(optarg, NULL, 0);
@@ -62,49 +75,83 @@ int main(int argc, char **argv) {
 	}
 
 	// Print the usage and exit if an error occurred during argument parsing.
+	if (mflg > 0 && nflg > 0) {
+		fprintf(stderr, "\n\t-m and -n can't be used simultaneously!\n\n");
+		errflg++;
+	}
+
 	if (errflg || lflg <= 0) {
 		fprintf(stderr, "usage: [-v] [-o FILE] [-l LENGTH] [file]\n"\
                         "\n\t-o FILE   the output file prefix"\
 						"\n\t-l LEVEL  the level of the tree"\
 						"\n\t-n        do not sort and unique input"\
+						"\n\t-m MB     sort and unique in runs of MB spilled to $TMPDIR"\
                         "\n\t-v        be more verbose"\
                         "\n\n");
 		exit(2);
 	}
 
-	// Load the integers.
-	array_init(&s, 10);
-	count = array_of_file(&s, filename);
-	if (count == 0) {
-		fprintf(stderr, "Can't load %s\n", filename);
-		return 1;
-	}
-	if (s.used != count) {
-		fprintf(stderr, "Array size and load count do not match\n");
-		return 2;
-	}
-	if (s.used == 0) {
-		fprintf(stderr, "No integers loaded (empty file)\n");
-		return 3;
-	}
-
 	if (out_filename != NULL && vflg > 0) {
 		printf("output is going to be saved in '%s'\n", out_filename);
 	}
 
-	if (nflg == 0) {
+	array_init(&s, 10);
+	if (mflg > 0) {
+		// Sort and unique the integers in temporary files instead of loading
+		// them (see [extsort](extsort.html)). The chunks are read back in
+		// order.
+		in = strcmp(filename, "-") == 0 ? stdin : fopen(filename, "r");
+		if (in == NULL || (sorted = extsort_tmpfile()) == NULL) {
+			fprintf(stderr, "Can't load %s\n", filename);
+			return 1;
+		}
 		if (vflg > 0)
-			printf("sorting the input integers...\n");
-		array_msort(&s);
-
+			printf("sorting and finding unique integers in runs of %ld MB...\n", budget_mb);
+		count = array_extsort(in, sorted, (size_t)budget_mb << 20, 1, &wc);
+		if (in != stdin)
+			fclose(in);
+		if (wc == 0) {
+			fprintf(stderr, "No integers loaded (empty file)\n");
+			return 3;
+		}
+		printf("unique: %zu / %zu\n", count, wc);
+		rewind(sorted);
+	} else if (nflg > 0 && fileindex_open(&fidx, filename)) {
+		// Unsorted chunks are ranges of the file, they are read by the index
+		// sidecar (see [fileindex](fileindex.html)).
 		if (vflg > 0)
-			printf("finding unique integers...\n");
-		array_init(&uniques, 10);
-		array_unique(&uniques, &s);
-		printf("unique: %zu / %zu\n", uniques.used, s.used);
-
-		count = uniques.used;
+			printf("reading the chunks by the index of '%s'\n", filename);
+		count = fidx.count;
+		indexed = 1;
 	} else {
+		// Load the integers.
+		count = array_of_file(&s, filename);
+		if (count == 0) {
+			fprintf(stderr, "Can't load %s\n", filename);
+			return 1;
+		}
+		if (s.used != count) {
+			fprintf(stderr, "Array size and load count do not match\n");
+			return 2;
+		}
+		if (s.used == 0) {
+			fprintf(stderr, "No integers loaded (empty file)\n");
+			return 3;
+		}
+
+		// Drop the duplicates by hash first, so only the unique integers are
+		// sorted.
+		if (nflg == 0) {
+			if (vflg > 0)
+				printf("finding unique integers...\n");
+			count = s.used;
+			array_dedup(&s, NULL);
+			printf("unique: %zu / %zu\n", s.used, count);
+
+			if (vflg > 0)
+				printf("sorting the unique integers...\n");
+			array_msort(&s);
+		}
 		count = s.used;
 	}
 
@@ -169,13 +216,14 @@ int main(int argc, char **argv) {
 
 			array_init(&o, length);
 
-			for (j=0; j<length; j++) {
-				if (nflg == 0) {
-					array_add(&o, uniques.array[index+j]);
-				} else {
+			if (sorted != NULL) {
+				j = array_read_stdio(&o, sorted, length);
+			} else if (indexed) {
+				j = fileindex_read(&fidx, &o, index, length);
+			} else {
+				for (j=0; j<length; j++) {
 					array_add(&o, s.array[index+j]);
 				}
-
 			}
 
 			if (snprintf ( chunk_name, MAX_CHUNK_NAME_LENGTH, "%s_%0*zu-%0*zu.lst", out_filename, padding, index, padding, index+j) < 0) {
@@ -322,9 +370,10 @@ console.log('rest', rest, restRatio);
 	*/
 
 	array_clear(&s);
-	if (nflg == 0) {
-		array_clear(&uniques);
-	}
+	if (sorted != NULL)
+		fclose(sorted);
+	if (indexed)
+		fileindex_close(&fidx);
 
 	return r;
 }
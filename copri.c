@@ -11,12 +11,59 @@
 #include <unistd.h>
 #include <gmp.h>
 #include "copri.h"
+#include "memory.h"
+#include "kernel.h"
+#include "divide_conquer.h"
+#include "hash.h"
 #include "config.h"
 #if USE_OPENMP
 #include <omp.h>
 #endif
 
+// The strategy used by `split_index`.
+static int split_mode = SPLIT_COUNT;
 
+// Called by `cb` if a subtree contains a shared factor.
+static cb_found_func cb_found = NULL;
+
+// ### Splitting a set
+
+// All recursive functions select T ⊆ S by splitting the index range
+// `[from, to]` into `[from, m]` and `[m+1, to]`. This function returns `m`.
+//
+// `SPLIT_COUNT` selects #T = ⌊#S/2⌋ elements as described in the paper.
+// `SPLIT_BITS` selects T such that both halves carry about the same amount
+// of bits. This keeps the multiplications and the parallel subtrees balanced
+// if integers of different sizes (1024, 2048 and 4096 bit keys) are mixed.
+size_t split_index(mpz_t *array, size_t from, size_t to) {
+	size_t n = to - from, i, bits, total = 0, sum = 0;
+
+	if (split_mode != SPLIT_BITS || n < 2) {
+		return to - n/2 - 1;
+	}
+
+	for (i = from; i <= to; i++) {
+		total += mpz_sizeinbase(array[i], 2);
+	}
+
+	// Walk until the left half holds at least half of the bits and check
+	// if the split is more balanced without the last element.
+	for (i = from; i < to; i++) {
+		bits = mpz_sizeinbase(array[i], 2);
+		sum += bits;
+		if (2 * sum >= total) {
+			if (i > from && total - 2 * (sum - bits) < 2 * sum - total)
+				return i - 1;
+			return i;
+		}
+	}
+	return to - 1;
+}
+
+// Set the strategy used by `split_index` to `SPLIT_COUNT` or `SPLIT_BITS`.
+void set_split_mode(int mode) {
+	split_mode = mode;
+}
 
 // ###Compute a^2^n.
 
@@ -256,7 +303,7 @@ const mpz_t b) {
 // See [prod test](test-prod.html) for basic usage.
 void prod(mpz_pool *pool, mpz_t rot, mpz_t * array,
 size_t from, size_t to) {
-	size_t n = to - from;
+	size_t n = to - from, m;
 	mpz_t x, y;
 
 	//  If #S = 1: Find a ∈ S. Print a. Stop.
@@ -265,15 +312,23 @@ size_t from, size_t to) {
 		return;
 	}
 
+	// If #S = 2: Print the product of both, the moduli are multiplied by a
+	// [fixed-width kernel](kernel.html) without copying them first.
+	if (n == 1) {
+		kernel_mul(rot, array[from], array[to]);
+		return;
+	}
+
 	// Select T ⊆ S with #T = b#S/2c.
 	//
 	// Compute X ← prod(T).
+	m = split_index(array, from, to);
 	pool_pop(pool, x);
-	prod(pool, x, array, from, to - n/2 - 1);
+	prod(pool, x, array, from, m);
 
 	// Compute Y ← prod(S−T).
 	pool_pop(pool, y);
-	prod(pool, y, array, to - n/2, to);
+	prod(pool, y, array, m + 1, to);
 
 	// Print XY.
 	mpz_mul(rot, x, y);
@@ -283,10 +338,20 @@ size_t from, size_t to) {
 	pool_push(pool, y);
 }
 
+static void prod_merge(mpz_pool *pool, mpz_t rot, const mpz_t a, const mpz_t b) {
+	kernel_mul(rot, a, b);
+}
+
 // #### array verison
 // Compute product of an `mpz_array` and store it in `mpz_t rot`.
+//
+// Halving by count builds the same tree level by level, so the product is
+// computed by the parallel [divide_conquer](divide_conquer.html) reduction.
+// Splitting by bits needs the recursion.
 void array_prod(mpz_pool *pool, mpz_array *a, mpz_t rot) {
-	if (a->used > 0)
+	if (a->used > 1 && split_mode == SPLIT_COUNT)
+		array_divide_conquer(pool, rot, a, prod_merge);
+	else if (a->used > 0)
 		prod(pool, rot, a->array, 0, a->used-1);
 	else {
 		mpz_set_ui(rot, 1);
@@ -304,7 +369,7 @@ void array_prod(mpz_pool *pool, mpz_array *a, mpz_t rot) {
 void split(mpz_pool *pool, mpz_array *ret, const mpz_t a,
 mpz_t *p, size_t from, size_t to) {
 	mpz_t b, x;
-	size_t n = to - from;
+	size_t n = to - from, m;
 
 	// **Sep 2**
 	//
@@ -327,8 +392,9 @@ mpz_t *p, size_t from, size_t to) {
 	// **Sep 3**
 	//
 	//  Select Q ⊆ P with #Q = b#P/2c.
-	split(pool, ret, b, p, from, to - n/2 - 1);
-	split(pool, ret, b, p, to - n/2, to);
+	m = split_index(p, from, to);
+	split(pool, ret, b, p, from, m);
+	split(pool, ret, b, p, m + 1, to);
 
 	// Free the memory.
 	pool_push(pool, b);
@@ -488,6 +554,47 @@ mpz_array *q) {
 	}
 }
 
+// #### shared factor test
+
+// Test if the coprime base S of P ∪ Q contains an element which is neither
+// in P nor in Q. This happens if and only if P and Q share a factor (or an
+// element). P and Q are looked up in hash sets on their own arrays, so
+// nothing is copied or sorted.
+static int cb_changed(mpz_array *s, mpz_array *p, mpz_array *q) {
+	mpz_hashset hp, hq;
+	size_t i;
+	int r = 0;
+
+	if (s->used != p->used + q->used)
+		return 1;
+
+	hashset_init(&hp, p, p->used);
+	hashset_init(&hq, q, q->used);
+	for (i = 0; i < p->used; i++)
+		hashset_add(&hp, i);
+	for (i = 0; i < q->used; i++)
+		hashset_add(&hq, i);
+	for (i = 0; i < s->used; i++) {
+		if (hashset_find(&hp, s->array[i]) == HASHSET_NONE &&
+			hashset_find(&hq, s->array[i]) == HASHSET_NONE) {
+			r = 1;
+			break;
+		}
+	}
+	hashset_clear(&hp);
+	hashset_clear(&hq);
+	return r;
+}
+
+// Set a function which is called by `cb` as soon as the coprime base of a
+// subtree s[from..to] shows a shared factor. The function gets the coprime
+// base of the subtree and can extract its factors while `cb` continues.
+// It is not called for the root, whose base is the result of `cb`.
+// `NULL` disables the callback.
+void set_cb_found(cb_found_func found) {
+	cb_found = found;
+}
+
 // ### Computing a coprime base for a finite set
 
 // This algorithm computes the natural coprime base for any finite subset of a free coid.
@@ -496,81 +603,57 @@ mpz_array *q) {
 // Algorithm 18.1 [PDF page 24](http://cr.yp.to/lineartime/dcba-20040404.pdf)
 //
 // See [cb test](test-cb.html) for basic usage.
-void cb(mpz_pool *pool, mpz_array *ret, mpz_t *s,
-size_t from, size_t to) {
-	size_t n = to - from;
-	mpz_array p, q;
-#if USE_OPENMP
-	mpz_pool pool_p, pool_q;
-#endif
-
-	// If #S = 1: Find a ∈ S. Print a if a != 1. Stop.
-	if (n == 0) {
-		if (mpz_cmp_ui(s[from], 0) == 0) {
-			fprintf(stderr, "warning adding 0 in cb\n");
-		} else {
-			if (mpz_cmp_ui(s[from], 1) != 0) {
-				array_add(ret, s[from]);
-			}
-		}
-		return;
-	}
-
-// ## OpenMP multithreading
-// Execute both recrusive `cb` calls in parallel.
+//
+// The set is reduced bottom up by [divide_conquer_bases](divide_conquer.html)
+// along the tree of `split_index`. A merge runs as soon as the bases of
+// both halves are computed, a fixed team of threads shares the merges.
 //
 // `export OMP_NUM_THREADS=4` to set the maximal thread number.
-	array_init(&p, n);
-	array_init(&q, n);
-#if USE_OPENMP
-	const int parent = omp_get_thread_num();
-#pragma omp parallel sections
-{
- #pragma omp section
- {
-	const int id = omp_get_thread_num();
-	if (id != parent) {
-		/* printf("New thread\n"); */
-		pool_init(&pool_p, 0);
-		cb(&pool_p, &p, s, from, to - n/2 - 1);
-		pool_clear(&pool_p);
-	} else {
-		cb(pool, &p, s, from, to - n/2 - 1);
-	}
- }
- #pragma omp section
- {
-	const int id = omp_get_thread_num();
-	if (id != parent) {
-		/* printf("New thread\n"); */
-		pool_init(&pool_q, 0);
-		cb(&pool_q, &q, s, to - n/2, to);
-		pool_clear(&pool_q);
-	} else {
-		cb(pool, &q, s, to - n/2, to);
+
+// If #S = 1: Find a ∈ S. Print a if a != 1.
+static void cb_leaf(mpz_pool *pool, mpz_array *ret, mpz_t *s, size_t i) {
+	if (mpz_cmp_ui(s[i], 0) == 0) {
+		fprintf(stderr, "warning adding 0 in cb\n");
+	} else if (mpz_cmp_ui(s[i], 1) != 0) {
+		array_add(ret, s[i]);
 	}
- }
 }
-#else
-	cb(pool, &p, s, from, to - n/2 - 1);
-	cb(pool, &q, s, to - n/2, to);
-#endif
-	// Print cbmerge(P∪Q)
-	if (q.used && p.used) {
-		cbmerge(pool, ret, &p, &q);
-	} else if(!q.used && p.used) {
-		array_add_array(ret, &p);
+
+// Print cbmerge(P∪Q)
+//
+// The temporaries of `cbmerge` are taken from the thread-local
+// [arena](memory.html#arenas) if it is enabled, only the merged base
+// and the free integers of the pool are copied out. `depth` is the depth in
+// the tree, it is passed to the [memory accounting](memory.html) to record
+// a high-water mark per depth.
+static void cb_merge(mpz_pool *pool, mpz_array *ret, mpz_array *p, mpz_array *q,
+mpz_t *s, size_t from, size_t to, int depth) {
+	size_t mark;
+
+	memory_set_depth(depth);
+	if (q->used && p->used) {
+		mark = memory_arena_begin();
+		cbmerge(pool, ret, p, q);
+		memory_arena_keep(pool->array + pool->used, pool->size - pool->used);
+		memory_arena_end(mark, ret, 0);
+		if (cb_found != NULL && depth > 0 && cb_changed(ret, p, q)) {
+			cb_found(pool, s, from, to, ret);
+		}
+	} else if(!q->used && p->used) {
+		array_add_array(ret, p);
 		fprintf(stderr, "warning: q is empty in cb\n");
-	} else if(q.used && !p.used) {
-		array_add_array(ret, &q);
+	} else if(q->used && !p->used) {
+		array_add_array(ret, q);
 		fprintf(stderr, "warning: p is empty in cb\n");
 	} else {
 		fprintf(stderr, "warning: p an q are empty in cb\n");
 	}
+}
 
-	// Free the memory.
-	array_clear(&p);
-	array_clear(&q);
+void cb(mpz_pool *pool, mpz_array *ret, mpz_t *s,
+size_t from, size_t to) {
+	memory_set_depth(0);
+	divide_conquer_bases(pool, ret, s, from, to, split_index, cb_leaf, cb_merge);
 }
 
 // #### array verison
@@ -581,6 +664,91 @@ void array_cb(mpz_pool *pool, mpz_array *ret, mpz_array *s) {
 		fprintf(stderr, "array_cb on empty array\n");
 }
 
+// ### Computing a coprime base for integers of mixed sizes
+
+// The integers are put into buckets of `width` bits by their size. The coprime
+// bases of the buckets are computed in parallel and merged by `cbmerge`
+// from the smallest to the largest bucket. Because cb(S ∪ T) = cb(cb(S) ∪ cb(T))
+// the result is the coprime base computed by `array_cb`, but small keys are
+// never multiplied with the huge products of large keys inside `cb`.
+//
+// See [cb test](test-cb.html) for basic usage.
+void array_cb_buckets(mpz_pool *pool, mpz_array *ret, mpz_array *s,
+size_t width) {
+	size_t i, k, count, bits, max = 0;
+	mpz_array *buckets, *bases, acc, t;
+
+	if (s->used == 0) {
+		fprintf(stderr, "array_cb_buckets on empty array\n");
+		return;
+	}
+	if (width < 1) width = 1;
+
+	// Put every integer into the bucket of its size.
+	for (i = 0; i < s->used; i++) {
+		bits = mpz_sizeinbase(s->array[i], 2);
+		if (bits > max) max = bits;
+	}
+	count = (max - 1) / width + 1;
+	buckets = (mpz_array *)malloc(count * sizeof(mpz_array));
+	bases = (mpz_array *)malloc(count * sizeof(mpz_array));
+	for (k = 0; k < count; k++) {
+		array_init(&buckets[k], 0);
+		array_init(&bases[k], 0);
+	}
+	for (i = 0; i < s->used; i++) {
+		bits = mpz_sizeinbase(s->array[i], 2);
+		array_add(&buckets[(bits - 1) / width], s->array[i]);
+	}
+
+	// Compute the coprime base of every bucket. Additional threads use
+	// their own pool like the parallel sections in `cb`.
+#if USE_OPENMP
+	const int parent = omp_get_thread_num();
+#pragma omp parallel for schedule(dynamic)
+	for (k = 0; k < count; k++) {
+		mpz_pool pool_k;
+		if (buckets[k].used == 0) continue;
+		if (omp_get_thread_num() != parent) {
+			pool_init(&pool_k, 0);
+			array_cb(&pool_k, &bases[k], &buckets[k]);
+			pool_clear(&pool_k);
+		} else {
+			array_cb(pool, &bases[k], &buckets[k]);
+		}
+	}
+#else
+	for (k = 0; k < count; k++) {
+		if (buckets[k].used == 0) continue;
+		array_cb(pool, &bases[k], &buckets[k]);
+	}
+#endif
+
+	// Merge the bases of the buckets.
+	array_init(&acc, s->used);
+	for (k = 0; k < count; k++) {
+		if (bases[k].used == 0) continue;
+		if (acc.used == 0) {
+			array_add_array(&acc, &bases[k]);
+		} else {
+			array_init(&t, acc.used + bases[k].used);
+			cbmerge(pool, &t, &acc, &bases[k]);
+			array_clear(&acc);
+			acc = t;
+		}
+	}
+	array_add_array(ret, &acc);
+
+	// Free the memory.
+	for (k = 0; k < count; k++) {
+		array_clear(&buckets[k]);
+		array_clear(&bases[k]);
+	}
+	free(buckets);
+	free(bases);
+	array_clear(&acc);
+}
+
 
 // ### The reduce function
 
@@ -659,7 +827,7 @@ const mpz_t p, const mpz_t a) {
 int find_factor(mpz_pool *pool, mpz_array *out, const mpz_t a0,
 const mpz_t a, mpz_t *p, size_t from, size_t to) {
 	mpz_t m, c, y, b, c2;
-	size_t n = to - from;
+	size_t n = to - from, k;
 	unsigned int r = 1;
 
 	// If #P = 1: Find p ∈ P. Compute (n, c) ← reduce(p,a) by Algorithm 19.2. If
@@ -686,10 +854,11 @@ const mpz_t a, mpz_t *p, size_t from, size_t to) {
 		return r;
 	}
 	// Select Q ⊆ P with #Q = b#P/2c.
+	k = split_index(p, from, to);
 
 	// Compute y ← prod Q
 	pool_pop(pool, y);
-	prod(pool, y, p, from, to - n/2 - 1);
+	prod(pool, y, p, from, k);
 
 	// Compute (b, c) ← (ppi,ppo)(a, y)
 	pool_pop(pool, b);
@@ -698,11 +867,11 @@ const mpz_t a, mpz_t *p, size_t from, size_t to) {
 
 	// Apply Algorithm 20.1 to (b,Q) recursively. If Algorithm 20.1 fails, proclaim
 	// failure and stop.
-	if (!find_factor(pool, out, a0, b, p, from, to - n/2 - 1)) {
+	if (!find_factor(pool, out, a0, b, p, from, k)) {
 		r = 0;
 	// Apply Algorithm 20.1 to (c,P−Q) recursively. If Algorithm 20.1 fails, proclaim
 	// failure and stop.
-	} else if (!find_factor(pool, out, a0, c2, p, to - n/2, to)) {
+	} else if (!find_factor(pool, out, a0, c2, p, k + 1, to)) {
 		r = 0;
 	}
 
@@ -736,7 +905,7 @@ void find_factors(mpz_pool *pool, mpz_array *out, mpz_t *s,
 size_t from, size_t to, mpz_array *p) {
 	mpz_t x, y, z;
 	mpz_array d, q;
-	size_t i, n = to - from;
+	size_t i, m, n = to - from;
 
 	pool_pop(pool, x);
 	array_prod(pool, p, x);
@@ -759,8 +928,9 @@ size_t from, size_t to, mpz_array *p) {
 	if (n == 0) {
 		array_find_factor(pool, out, y, &q);
 	} else {
-		find_factors(pool, out, s, from, to - n/2 - 1, &q);
-		find_factors(pool, out, s, to - n/2, to, &q);
+		m = split_index(s, from, to);
+		find_factors(pool, out, s, from, m, &q);
+		find_factors(pool, out, s, m + 1, to, &q);
 	}
 
 	pool_push(pool, x);
@@ -778,3 +948,253 @@ mpz_array *s, mpz_array *p) {
 	else
 		fprintf(stderr, "array_printfactors_set on empty array\n");
 }
+
+
+// ### Product tree
+
+// Store the products of all subtrees of s[from..to] in `tree`, split like
+// `prod`. The subtree of node k starts at index k: the left subtree of a
+// node with the leaves s[from..m] is at k + 1, the right one at
+// k + 2(m - from + 1). A tree of n leaves has 2n - 1 nodes.
+static void prod_tree(mpz_t *tree, size_t k, mpz_t *s, size_t from, size_t to) {
+	size_t m, r;
+
+	if (from == to) {
+		mpz_set(tree[k], s[from]);
+		return;
+	}
+	m = split_index(s, from, to);
+	r = k + 2 * (m - from + 1);
+	prod_tree(tree, k + 1, s, from, m);
+	prod_tree(tree, r, s, m + 1, to);
+	if (m == from && m + 1 == to)
+		kernel_mul(tree[k], s[from], s[to]);
+	else
+		mpz_mul(tree[k], tree[k + 1], tree[r]);
+}
+
+static mpz_t *prod_tree_init(mpz_t *s, size_t from, size_t to) {
+	size_t i, n = 2 * (to - from) + 1;
+	mpz_t *tree = (mpz_t *)malloc(n * sizeof(mpz_t));
+
+	for (i = 0; i < n; i++)
+		mpz_init(tree[i]);
+	prod_tree(tree, 0, s, from, to);
+	return tree;
+}
+
+static void prod_tree_clear(mpz_t *tree, size_t leaves) {
+	size_t i;
+
+	for (i = 0; i < 2 * leaves - 1; i++)
+		mpz_clear(tree[i]);
+	free(tree);
+}
+
+// Compute a mod s for every leaf s of the subtree k of a product tree of
+// s[from..to]. `a` is reduced by the product of the subtree first.
+static void remainders_tree(mpz_pool *pool, mpz_array *ret, const mpz_t a,
+mpz_t *tree, size_t k, mpz_t *s, size_t from, size_t to) {
+	mpz_t r;
+	size_t m;
+
+	pool_pop(pool, r);
+	mpz_fdiv_r(r, a, tree[k]);
+	if (from == to) {
+		array_add(ret, r);
+	} else {
+		m = split_index(s, from, to);
+		remainders_tree(pool, ret, r, tree, k + 1, s, from, m);
+		remainders_tree(pool, ret, r, tree, k + 2 * (m - from + 1), s, m + 1, to);
+	}
+	pool_push(pool, r);
+}
+
+// ### Remainder tree
+
+// Compute a mod s for every s ∈ S and add the remainders to `ret` in the
+// order of S. `a` is reduced by the product of each half of S before
+// descending, so every remainder is computed from a small integer. The
+// products of the halves are computed once by a product tree.
+//
+// See [remainders test](test-remainders.html) for basic usage.
+void remainders(mpz_pool *pool, mpz_array *ret, const mpz_t a,
+mpz_t *s, size_t from, size_t to) {
+	mpz_t *tree;
+
+	tree = prod_tree_init(s, from, to);
+	remainders_tree(pool, ret, a, tree, 0, s, from, to);
+	prod_tree_clear(tree, to - from + 1);
+}
+
+// #### array verison
+void array_remainders(mpz_pool *pool, mpz_array *ret,
+const mpz_t a, mpz_array *s) {
+	if (s->used > 0)
+		remainders(pool, ret, a, s->array, 0, s->used-1);
+	else
+		fprintf(stderr, "array_remainders on empty array\n");
+}
+
+
+// ### Screening a set by a product
+
+// Compute gcd(s, a) for every s ∈ S and add it to `ret` in the order of S.
+// This finds all integers in S which share a factor with `a`, e.g. the
+// product of known primes. The remainders a mod s are computed by remainder
+// trees over blocks of `SCREEN_BLOCK_SIZE` integers, so only the products of
+// one block are kept in memory.
+//
+// See [remainders test](test-remainders.html) for basic usage.
+void screen(mpz_pool *pool, mpz_array *ret, const mpz_t a,
+mpz_t *s, size_t from, size_t to) {
+	mpz_array rem;
+	mpz_t g;
+	size_t i, k, end;
+
+	pool_pop(pool, g);
+	for (i = from; i <= to; i += SCREEN_BLOCK_SIZE) {
+		end = i + SCREEN_BLOCK_SIZE - 1;
+		if (end > to) end = to;
+
+		// Compute a mod s for the block and the gcd with every s.
+		array_init(&rem, end - i + 1);
+		remainders(pool, &rem, a, s, i, end);
+		for (k = 0; k < rem.used; k++) {
+			kernel_gcd(g, rem.array[k], s[i + k]);
+			array_add(ret, g);
+		}
+		array_clear(&rem);
+	}
+	pool_push(pool, g);
+}
+
+// #### array verison
+void array_screen(mpz_pool *pool, mpz_array *ret,
+const mpz_t a, mpz_array *s) {
+	if (s->used > 0)
+		screen(pool, ret, a, s->array, 0, s->used-1);
+	else
+		fprintf(stderr, "array_screen on empty array\n");
+}
+
+
+// ### Factoring RSA moduli over a coprime base
+
+// For RSA moduli it is enough to know which element of the coprime base P
+// divides which key. The keys in `idx` share a factor with prod P[from..to].
+// They are pushed down the product tree `ptree` of P, the subtree of
+// P[from..to] is at node k: a key follows a subtree if
+// gcd(key, prod subtree mod key) != 1. The remainders of each level are
+// computed by a remainder tree over the keys.
+//
+// `div[i]` is set to one plus the index of the first element of P which
+// divides the key `s[i]`.
+static void rsa_divisors(mpz_pool *pool, size_t *div, mpz_t *s,
+size_t *idx, size_t count, mpz_t *p, mpz_t *ptree, size_t k, size_t from, size_t to) {
+	mpz_array keys, rem;
+	mpz_t g;
+	size_t i, n, m, half, lo, hi, node, *sub;
+
+	// If #P = 1: p divides every key. Keep the first divisor.
+	if (from == to) {
+		for (i = 0; i < count; i++) {
+			if (div[idx[i]] == 0)
+				div[idx[i]] = from + 1;
+		}
+		return;
+	}
+
+	array_init(&keys, count);
+	for (i = 0; i < count; i++) {
+		array_add(&keys, s[idx[i]]);
+	}
+	sub = (size_t *)malloc(count * sizeof(size_t));
+	pool_pop(pool, g);
+
+	// Descend into the left half first to find the first divisor.
+	m = split_index(p, from, to);
+	for (half = 0; half < 2; half++) {
+		lo = half ? m + 1 : from;
+		hi = half ? to : m;
+		node = half ? k + 2 * (m - from + 1) : k + 1;
+
+		// Compute prod P[lo..hi] mod k for every key k.
+		array_init(&rem, count);
+		array_remainders(pool, &rem, ptree[node], &keys);
+
+		// Keep the keys with gcd(k, prod mod k) != 1.
+		n = 0;
+		for (i = 0; i < count; i++) {
+			kernel_gcd(g, rem.array[i], keys.array[i]);
+			if (mpz_cmp_ui(g, 1) != 0)
+				sub[n++] = idx[i];
+		}
+		array_clear(&rem);
+
+		if (n > 0)
+			rsa_divisors(pool, div, s, sub, n, p, ptree, node, lo, hi);
+	}
+
+	// Free the memory.
+	pool_push(pool, g);
+	free(sub);
+	array_clear(&keys);
+}
+
+// This computes the same triples (a, p, a/p) as `find_factors` if P is the
+// coprime base of S, but skips the `reduce` and `find_factor` recursion.
+// p is the first element of P which divides a; keys that are elements of
+// P are not printed. They are dropped by a hash lookup before the descent,
+// usually only a few keys are left.
+//
+// See [rsafactors test](test-rsafactors.html) for basic usage.
+void rsa_find_factors(mpz_pool *pool, mpz_array *out, mpz_t *s,
+size_t from, size_t to, mpz_array *p) {
+	size_t i, count = 0, n = to - from + 1, *div, *idx;
+	mpz_hashset h;
+	mpz_t *ptree;
+	mpz_t y;
+
+	div = (size_t *)calloc(n, sizeof(size_t));
+	idx = (size_t *)malloc(n * sizeof(size_t));
+	hashset_init(&h, p, p->used);
+	for (i = 0; i < p->used; i++)
+		hashset_add(&h, i);
+	for (i = 0; i < n; i++) {
+		if (hashset_find(&h, s[from + i]) == HASHSET_NONE)
+			idx[count++] = i;
+	}
+	hashset_clear(&h);
+
+	// Every other key is divided by an element of the coprime base.
+	if (count > 0) {
+		ptree = prod_tree_init(p->array, 0, p->used - 1);
+		rsa_divisors(pool, div, s + from, idx, count, p->array, ptree, 0, 0, p->used - 1);
+		prod_tree_clear(ptree, p->used);
+	}
+
+	pool_pop(pool, y);
+	for (i = 0; i < n; i++) {
+		if (div[i] == 0 || mpz_cmp(s[from + i], p->array[div[i] - 1]) == 0)
+			continue;
+		mpz_fdiv_q(y, s[from + i], p->array[div[i] - 1]);
+		array_add(out, s[from + i]);
+		array_add(out, p->array[div[i] - 1]);
+		array_add(out, y);
+	}
+
+	// Free the memory.
+	pool_push(pool, y);
+	free(div);
+	free(idx);
+}
+
+// #### array verison
+void array_rsa_find_factors(mpz_pool *pool, mpz_array *out,
+mpz_array *s, mpz_array *p) {
+	if (s->used > 0 && p->used > 0)
+		rsa_find_factors(pool, out, s->array, 0, s->used-1, p);
+	else
+		fprintf(stderr, "array_rsa_find_factors on empty array\n");
+}
@@ -9,6 +9,14 @@
 #include "array.h"
 #include "pool.h"
 
+// Strategies to split a set in the recursive functions.
+#define SPLIT_COUNT 0
+#define SPLIT_BITS  1
+
+size_t split_index(mpz_t *array, size_t from, size_t to);
+
+void set_split_mode(int mode);
+
 void two_power(mpz_t rot, unsigned long long n);
 
 void gcd_ppi_ppo(mpz_pool *pool, mpz_t gcd, mpz_t ppi, mpz_t ppo, const mpz_t a, const mpz_t c);
@@ -33,10 +41,16 @@ void cbextend(mpz_pool *pool, mpz_array *ret, mpz_array *p, const mpz_t b);
 
 void cbmerge(mpz_pool *pool, mpz_array *s, mpz_array *p, mpz_array *q);
 
+typedef void (*cb_found_func)(mpz_pool *pool, mpz_t *s, size_t from, size_t to, mpz_array *base);
+
+void set_cb_found(cb_found_func found);
+
 void cb(mpz_pool *pool, mpz_array *ret, mpz_t *s, size_t from, size_t to);
 
 void array_cb(mpz_pool *pool, mpz_array *ret, mpz_array *s);
 
+void array_cb_buckets(mpz_pool *pool, mpz_array *ret, mpz_array *s, size_t width);
+
 void reduce(mpz_pool *pool, mpz_t i, mpz_t pai, const mpz_t p, const mpz_t a);
 
 int find_factor(mpz_pool *pool, mpz_array *out, const mpz_t a0, const mpz_t a, mpz_t *p, size_t from, size_t to);
@@ -47,4 +61,19 @@ void find_factors(mpz_pool *pool, mpz_array *out, mpz_t *s, size_t from, size_t
 
 void array_find_factors(mpz_pool *pool, mpz_array *out, mpz_array *s, mpz_array *p);
 
+void remainders(mpz_pool *pool, mpz_array *ret, const mpz_t a, mpz_t *s, size_t from, size_t to);
+
+void array_remainders(mpz_pool *pool, mpz_array *ret, const mpz_t a, mpz_array *s);
+
+// The number of integers reduced by one remainder tree in `screen`.
+#define SCREEN_BLOCK_SIZE 4096
+
+void screen(mpz_pool *pool, mpz_array *ret, const mpz_t a, mpz_t *s, size_t from, size_t to);
+
+void array_screen(mpz_pool *pool, mpz_array *ret, const mpz_t a, mpz_array *s);
+
+void rsa_find_factors(mpz_pool *pool, mpz_array *out, mpz_t *s, size_t from, size_t to, mpz_array *p);
+
+void array_rsa_find_factors(mpz_pool *pool, mpz_array *out, mpz_array *s, mpz_array *p);
+
 #endif /* COPRI_H */
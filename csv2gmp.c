@@ -9,18 +9,44 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <stdint.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <gmp.h>
+#include "source.h"
+#include "config.h"
+#if USE_OPENMP
+#include <omp.h>
+#endif
 
-#define READ_BUF_SIZE 8192
 #define DEFAULT_MIN_LENGTH 512
 #define DEFAULT_MAX_LENGTH 8192
 
-typedef void (*readline_cb_t)(char* line, unsigned int len);
-void readline(FILE *fp, readline_cb_t readline_cb, unsigned int read_buffer_size);
-void readline_cb(char* line, unsigned int len);
+// The CSV is converted in windows of complete lines. A window is split into
+// chunks at line ends, the chunks are converted in parallel and their
+// output is written in order.
+#define WINDOW_SIZE (64 << 20)
+#define CHUNK_SIZE (1 << 20)
+
+// A chunk of lines and the raw gmp keys converted from it. `sources` has
+// the CSV offset of the line of every key if a sidecar is written.
+typedef struct {
+	const char *from;
+	const char *to;
+	uint64_t offset;
+	uint64_t line;
+	unsigned char *out;
+	size_t used;
+	size_t size;
+	size_t keys;
+	uint64_t *sources;
+	size_t sources_size;
+} csv_chunk;
 
 FILE *out;
+FILE *src = NULL;
 long int min_length = DEFAULT_MIN_LENGTH;
 long int max_length = DEFAULT_MAX_LENGTH;
 size_t key_count = 0;
@@ -28,6 +54,10 @@ size_t key_count = 0;
 // Define the variables set by the argument parser
 int c, vflg = 0, errflg = 0;
 
+size_t convert_lines(const char *data, size_t len, uint64_t offset, int last);
+int convert_mapped(FILE *csv);
+void convert_stream(FILE *csv);
+
 // # main
 
 // Read the command line arguments, open the output file and the csv file then
@@ -38,9 +68,10 @@ int main (int argc, char *argv[]) {
 
 	char* csv_filename = "-";
 	char* out_filename = "-";
+	char* src_filename = NULL;
 
 	// Read the command line arguments.
-	while ((c = getopt(argc, argv, ":vcpg:l:o:")) != -1) {
+	while ((c = getopt(argc, argv, ":vcpg:l:o:s:")) != -1) {
 		switch(c) {
 		case 'v':
 			vflg++;
@@ -56,6 +87,9 @@ int main (int argc, char *argv[]) {
 		case 'o':
 			out_filename = optarg;
 			break;
+		case 's':
+			src_filename = optarg;
+			break;
 		case ':':
 			fprintf(stderr, "Option -%c requires an operand\n", optopt);
 			errflg++;
@@ -73,12 +107,13 @@ int main (int argc, char *argv[]) {
 
 	// Print the usage and exit if an error occurred during argument parsing.
 	if (errflg) {
-		fprintf(stderr, "usage: [-vc] [-g min_keylength] [-l max_keylength] [-o gmp_file] [csv_file]\n"\
+		fprintf(stderr, "usage: [-vc] [-g min_keylength] [-l max_keylength] [-o gmp_file] [-s source_file] [csv_file]\n"\
 						"\n\t-v        be more verbose"\
 						"\n"\
 						"\n\t-g MIN_KEYLENGTH    the minimal key length (>=)"\
 						"\n\t-l MAX_KEYLENGTH    the maximum key length (<=)"\
 						"\n\t-o GMP_FILE         the gmp file to write"\
+						"\n\t-s SOURCE_FILE      append the csv offset of every key to SOURCE_FILE"\
 						"\n\n");
 		exit(2);
 	}
@@ -103,6 +138,18 @@ int main (int argc, char *argv[]) {
 		}
 	}
 
+	// Open the sidecar, it is appended to like the output file.
+	if (src_filename != NULL) {
+		src = fopen(src_filename, "a");
+		if (src == NULL) {
+			printf("Cannot save to file %s.\n", src_filename);
+			exit(3);
+		}
+		if (vflg > 0) {
+			fprintf(stderr, "Adding the csv offsets to file %s.\n", src_filename);
+		}
+	}
+
 	// Set `csv` to `stdin` if the filename is `-`.
 	if (strcmp(csv_filename, "-") == 0) {
 		csv = stdin;
@@ -123,12 +170,16 @@ int main (int argc, char *argv[]) {
 		}
 	}
 
-	// This calls `readline_cb` on every line of `csv`.
-	readline(csv, readline_cb, READ_BUF_SIZE);
+	// Map a regular file, read pipes in windows.
+	if (csv == stdin || !convert_mapped(csv)) {
+		convert_stream(csv);
+	}
 
 	// Colse the files.
 	fclose(csv);
 	fclose(out);
+	if (src != NULL)
+		fclose(src);
 
 	// Print the summary.
 	if (vflg > 0) {
@@ -138,122 +189,297 @@ int main (int argc, char *argv[]) {
 	return 0;
 }
 
-void readline_cb(char* line, unsigned int len) {
-	size_t write_len = 0;
-	unsigned int c = 0;
-	unsigned int c_start = 0;
-	unsigned int c_end = 0;
+// # hex decoding
+
+// The value of a hex digit or -1.
+static int hex_nibble(unsigned char c) {
+	if (c >= '0' && c <= '9') return c - '0';
+	if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+	return -1;
+}
+
+#define SWAR_HIGH 0x8080808080808080ULL
+#define SWAR_ONES 0x0101010101010101ULL
+
+// Decode 8 hex digits to 4 bytes in a 64 bit word. Returns 0 if `s`
+// contains a character which is not a hex digit.
+static int hex_word(unsigned char *d, const unsigned char *s) {
+	uint64_t x, digit, alpha, letter, v;
+	int i;
+
+	for (i = 7, x = 0; i >= 0; i--)
+		x = (x << 8) | s[i];
+	if (x & SWAR_HIGH)
+		return 0;
+	// Every byte is below 0x80, so adding up to 0x7f never carries into the
+	// next byte. A digit is `x ^ '0'` below 10, a letter is `(x | 0x20) ^
+	// 0x60` between 1 and 6.
+	digit = x ^ (0x30 * SWAR_ONES);
+	digit = ~(digit + 0x76 * SWAR_ONES) & SWAR_HIGH;
+	alpha = (x | 0x20 * SWAR_ONES) ^ (0x60 * SWAR_ONES);
+	letter = (alpha + 0x7f * SWAR_ONES) & ~(alpha + 0x79 * SWAR_ONES) & SWAR_HIGH;
+	if ((digit | letter) != SWAR_HIGH)
+		return 0;
+
+	// The low nibble plus 9 for letters is the value of the digit.
+	v = (x & 0x0f * SWAR_ONES) + ((x >> 6) & SWAR_ONES) * 9;
+	// Join the pairs of nibbles and move the 4 bytes together.
+	v = ((v & 0x00ff00ff00ff00ffULL) << 4) | ((v >> 8) & 0x00ff00ff00ff00ffULL);
+	v = (v | (v >> 8)) & 0x0000ffff0000ffffULL;
+	v = (v | (v >> 16)) & 0x00000000ffffffffULL;
+	for (i = 0; i < 4; i++)
+		d[i] = (unsigned char)(v >> (8 * i));
+	return 1;
+}
+
+// Decode `n` hex digits to `(n + 1) / 2` big endian bytes. Returns 0 if
+// `s` contains a character which is not a hex digit.
+static int hex_decode(unsigned char *d, const char *src, size_t n) {
+	const unsigned char *s = (const unsigned char *)src;
+	int hi, lo;
+
+	if (n % 2 == 1) {
+		if ((lo = hex_nibble(*s++)) < 0) return 0;
+		*d++ = (unsigned char)lo;
+		n--;
+	}
+	for (; n >= 8; n -= 8, s += 8, d += 4) {
+		if (!hex_word(d, s)) return 0;
+	}
+	for (; n >= 2; n -= 2, s += 2) {
+		if ((hi = hex_nibble(s[0])) < 0 || (lo = hex_nibble(s[1])) < 0) return 0;
+		*d++ = (unsigned char)(hi << 4 | lo);
+	}
+	return 1;
+}
+
+// # conversion
+
+// Append `n` bytes to the output of the chunk.
+static void chunk_write(csv_chunk *ch, const void *data, size_t n) {
+	while (ch->used + n > ch->size) {
+		ch->size = ch->size ? 2 * ch->size : 4096;
+		ch->out = (unsigned char *)realloc(ch->out, ch->size);
+	}
+	memcpy(ch->out + ch->used, data, n);
+	ch->used += n;
+}
+
+// Append a key in the raw gmp format of `mpz_out_raw`: the byte count as 4
+// byte big endian integer followed by the big endian bytes without leading
+// zeros. A negative key has the negated byte count.
+static void chunk_write_key(csv_chunk *ch, const unsigned char *bytes, size_t n, int negative) {
+	unsigned char h[4];
+	uint32_t count;
+
+	while (n > 0 && *bytes == 0) {
+		bytes++;
+		n--;
+	}
+	count = negative ? (uint32_t)-(int32_t)n : (uint32_t)n;
+	h[0] = (unsigned char)(count >> 24);
+	h[1] = (unsigned char)(count >> 16);
+	h[2] = (unsigned char)(count >> 8);
+	h[3] = (unsigned char)count;
+	chunk_write(ch, h, 4);
+	chunk_write(ch, bytes, n);
+	if (src != NULL) {
+		if (ch->keys == ch->sources_size) {
+			ch->sources_size = ch->sources_size ? 2 * ch->sources_size : 256;
+			ch->sources = (uint64_t *)realloc(ch->sources, ch->sources_size * sizeof(uint64_t));
+		}
+		ch->sources[ch->keys] = ch->line;
+	}
+	ch->keys++;
+}
+
+// Convert a line. The second column has to be "rsaEncryption", the fifth
+// contains the hex modulus after two characters and the tenth the key
+// length. The columns are not copied, `buf` is the decode buffer of the
+// chunk.
+static void convert_line(csv_chunk *ch, const char *line, size_t len, unsigned char **buf, size_t *size) {
+	const char *key = NULL;
+	char num[32], *str;
+	size_t c = 0, c_start = 0, c_end, key_len = 0, n;
 	int is_rsa = 0;
 	long int keylength = 0;
-	mpz_t key;
-
-	// Parse the line.
-	for (c_end = 0; c_end<=len; c_end++) {
-		if (line[c_end] == ',' || c_end == len) {
-			line[c_end] = '\0';
-			// Check if the second column contains "rsaEncryption".
-			if (c == 1) {
-				if (strncmp(line+c_start, "rsaEncryption", c_end-c_start) == 0) {
-					is_rsa = 1;
-				}
-			// Store the fourth column as `mpz_t`.
-			} else if(is_rsa && c == 4) {
-				mpz_init(key);
-				mpz_set_str(key, line+c_start+2, 16);
-			// Store the tenth column as the key length.
-			} else if(is_rsa && c == 9) {
-				keylength = strtol(line+c_start, NULL, 0);
-			}
-			c++;
-			c_start = c_end+1;
+	mpz_t x;
+
+	// Split the line at commas.
+	for (c_end = 0; c_end <= len; c_end++) {
+		if (c_end < len && line[c_end] != ',')
+			continue;
+		n = c_end - c_start;
+		// Check if the second column is a prefix of "rsaEncryption" like
+		// `strncmp` did.
+		if (c == 1) {
+			is_rsa = n <= 13 && memcmp(line + c_start, "rsaEncryption", n) == 0;
+		} else if (is_rsa && c == 4) {
+			key = line + c_start + 2;
+			key_len = n >= 2 ? n - 2 : 0;
+		} else if (is_rsa && c == 9) {
+			n = n < sizeof(num) - 1 ? n : sizeof(num) - 1;
+			memcpy(num, line + c_start, n);
+			num[n] = '\0';
+			keylength = strtol(num, NULL, 0);
 		}
+		c++;
+		c_start = c_end + 1;
 	}
 
-	// If the is an RSA key and the key length condition is meet write the
-	// key in raw gmp format to `out`.
-	if (is_rsa && keylength >= min_length && keylength <= max_length) {
-		write_len = mpz_out_raw(out, key);
-		if (write_len == 0) {
+	// If it is an RSA key and the key length condition is met write the key.
+	if (!is_rsa || keylength < min_length || keylength > max_length)
+		return;
+	if (*size < key_len / 2 + 1) {
+		*size = key_len / 2 + 1;
+		*buf = (unsigned char *)realloc(*buf, *size);
+	}
+	if (key_len == 0 || !hex_decode(*buf, key, key_len)) {
+		// Let GMP parse anything else, like whitespace.
+		str = (char *)malloc(key_len + 1);
+		memcpy(str, key != NULL ? key : "", key_len);
+		str[key_len] = '\0';
+		mpz_init(x);
+		mpz_set_str(x, str, 16);
+		if (*size < mpz_sizeinbase(x, 256)) {
+			*size = mpz_sizeinbase(x, 256);
+			*buf = (unsigned char *)realloc(*buf, *size);
+		}
+		mpz_export(*buf, &n, 1, 1, 1, 0, x);
+		chunk_write_key(ch, *buf, n, mpz_sgn(x) < 0);
+		mpz_clear(x);
+		free(str);
+		return;
+	}
+	chunk_write_key(ch, *buf, (key_len + 1) / 2, 0);
+}
+
+// Convert the lines of a chunk.
+static void convert_chunk(csv_chunk *ch) {
+	const char *line = ch->from, *end;
+	unsigned char *buf = NULL;
+	size_t size = 0;
+
+	while (line < ch->to) {
+		end = memchr(line, '\n', ch->to - line);
+		if (end == NULL)
+			end = ch->to;
+		ch->line = ch->offset + (uint64_t)(line - ch->from);
+		convert_line(ch, line, end - line, &buf, &size);
+		line = end + 1;
+	}
+	free(buf);
+}
+
+// Convert the complete lines of `data` and write the keys in order. `data`
+// starts at `offset` of the CSV. If `last` is set the data ends with the
+// last line, otherwise the bytes after the last newline are left. Returns
+// the number of bytes converted.
+size_t convert_lines(const char *data, size_t len, uint64_t offset, int last) {
+	csv_chunk *chunks;
+	const char *p, *end = data + len;
+	size_t n = 0, i;
+
+	if (!last) {
+		while (end > data && end[-1] != '\n')
+			end--;
+	}
+	if (end == data)
+		return 0;
+
+	// Split at the first newline after every `CHUNK_SIZE` bytes.
+	chunks = (csv_chunk *)calloc((end - data) / CHUNK_SIZE + 1, sizeof(csv_chunk));
+	for (p = data; p < end; n++) {
+		chunks[n].from = p;
+		chunks[n].offset = offset + (uint64_t)(p - data);
+		if ((size_t)(end - p) <= CHUNK_SIZE) {
+			p = end;
+		} else {
+			p = memchr(p + CHUNK_SIZE, '\n', end - p - CHUNK_SIZE);
+			p = p == NULL ? end : p + 1;
+		}
+		chunks[n].to = p;
+	}
+
+#if USE_OPENMP
+	#pragma omp parallel for schedule(dynamic)
+#endif
+	for (i = 0; i < n; i++) {
+		convert_chunk(&chunks[i]);
+	}
+
+	for (i = 0; i < n; i++) {
+		if (chunks[i].used > 0 && fwrite(chunks[i].out, 1, chunks[i].used, out) != chunks[i].used) {
 			fprintf(stderr, "Cannot write to file.\n");
 		} else {
-			key_count++;
+			key_count += chunks[i].keys;
+			if (src != NULL && source_write(src, chunks[i].sources, chunks[i].keys) != chunks[i].keys)
+				fprintf(stderr, "Cannot write to the sidecar.\n");
 		}
+		free(chunks[i].out);
+		free(chunks[i].sources);
 	}
+	free(chunks);
+	return end - data;
+}
 
-	// Free the memory.
-	if (is_rsa) {
-		mpz_clear(key);
+// # input
+
+// Map a regular file and convert it window by window. Returns 0 if the file
+// can't be mapped.
+int convert_mapped(FILE *csv) {
+	struct stat st;
+	const char *map;
+	size_t pos = 0, len, done;
+
+	if (fstat(fileno(csv), &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0)
+		return 0;
+	map = (const char *)mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fileno(csv), 0);
+	if (map == MAP_FAILED)
+		return 0;
+	madvise((void *)map, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+	for (len = WINDOW_SIZE; pos < (size_t)st.st_size; ) {
+		if (len > (size_t)st.st_size - pos)
+			len = (size_t)st.st_size - pos;
+		done = convert_lines(map + pos, len, pos, pos + len == (size_t)st.st_size);
+		// A line longer than the window needs a larger window.
+		if (done == 0) {
+			len *= 2;
+			continue;
+		}
+		pos += done;
+		len = WINDOW_SIZE;
 	}
+	munmap((void *)map, (size_t)st.st_size);
+	return 1;
 }
 
-// # readline
-//
-// read the file and call `readline_cb` on every line.
-void readline(FILE *fp, readline_cb_t readline_cb, unsigned int read_buffer_size) {
-	char *line_buf;
-	unsigned int line_buf_size = 1024;
-	unsigned int line_buf_index = 0;
-	char read_buf[read_buffer_size];
-	unsigned int line_start = 0;
-	unsigned int line_end = 0;
-	unsigned int line_chunck_size = 0;
-	unsigned int i = 0;
-	size_t bytes_read = 0;
-	unsigned int x = 0;
-
-	// Alloc the line buffer by guessed size.
-	line_buf = malloc(line_buf_size);
-	for (x = 0; x<line_buf_size; x++)
-		line_buf[x] = '?';
-
-	// Start looping until the end of the file is reached.
-	while(!feof(fp))
-	{
-		// Read the next `read_buffer_size` chunck of the file.
-		bytes_read = fread(&read_buf, 1, read_buffer_size, fp);
-
-		// Loop until the end of the chunck.
-    	while (line_end < bytes_read)
-    	{
-    		// Find the index of the next `\n` char.
-    		while (line_end < bytes_read && read_buf[line_end] != '\n')
-    			line_end++;
-
-    		// Store the size of line chunck.
-    		line_chunck_size = line_end - line_start;
-
-    		// Increase the size of the line buffer if needed.
-			while (line_buf_index+line_chunck_size+1 > line_buf_size)
-			{
-				line_buf_size *= 2;
-				line_buf = realloc(line_buf, line_buf_size);
-			}
-
-			// Copy the read buffer to the line buffer.
-			for (i=0; i<line_chunck_size; i++)
-				line_buf[line_buf_index+i] = read_buf[line_start+i];
-
-			// Set the new line start index and terminate the string by `\0`.
-			line_buf_index += i;
-			line_buf[line_buf_index] = '\0';
-
-			// Call the readline function if the line buffer ends with `\n`
-			if (read_buf[line_end] == '\n') {
-				readline_cb(line_buf, line_buf_index);
-				line_buf_index = 0;
-			}
-
-			// Move the chunck to the next index.
-    		line_end++;
-    		line_start = line_end;
-    	}
-
-    	// Reset the line indices.
-    	line_start = 0;
-    	line_end = 0;
-
-    }
-
-	// Free the line buffer.
-	free(line_buf);
+// Read a stream like stdin in windows, the incomplete last line of a window
+// is moved to the next window.
+void convert_stream(FILE *csv) {
+	char *buf;
+	size_t size = WINDOW_SIZE, used = 0, n, done;
+	uint64_t offset = 0;
+	int eof = 0;
+
+	buf = (char *)malloc(size);
+	while (!eof) {
+		n = fread(buf + used, 1, size - used, csv);
+		used += n;
+		eof = used < size && feof(csv);
+		done = convert_lines(buf, used, offset, eof);
+		if (done == 0 && !eof && used == size) {
+			size *= 2;
+			buf = (char *)realloc(buf, size);
+			continue;
+		}
+		memmove(buf, buf + done, used - done);
+		used -= done;
+		offset += done;
+		if (n == 0 && ferror(csv))
+			break;
+	}
+	free(buf);
 }
@@ -2,75 +2,380 @@
 #include <stdio.h>
 #include <unistd.h>
 #include "divide_conquer.h"
-#include "stack.h"
+#include "config.h"
+#if USE_OPENMP
+#include <omp.h>
+#endif
 
-// This algorithm will iterative simulate a recursive divide and conquer algorithm.
-size_t array_divide_conquer(mpz_pool *pool, mpz_t ret, mpz_array *in, void(*merge)(mpz_pool *, mpz_t, const mpz_t, const mpz_t)) {
-	size_t n = 1, index = 2, length = in->used, stack_len = 0, n_top;
-	mpz_t a, b, x;
-	mpz_ui_pair_stack *stack;
+typedef void (*dc_merge_func)(mpz_pool *, mpz_t, const mpz_t, const mpz_t);
+
+// Reduce the block `array[from..to]` depth first like `prod`, the
+// temporaries are taken from `pool`. A block is small enough to stay in
+// the cache.
+static void dc_block(mpz_pool *pool, mpz_t ret, mpz_t *array, size_t from, size_t to, dc_merge_func merge) {
+	size_t m;
+	mpz_t x, y;
+
+	if (from == to) {
+		mpz_set(ret, array[from]);
+		return;
+	}
+	if (to - from == 1) {
+		merge(pool, ret, array[from], array[to]);
+		return;
+	}
+	m = from + (to - from) / 2;
+	pool_pop(pool, x);
+	dc_block(pool, x, array, from, m, merge);
+	pool_pop(pool, y);
+	dc_block(pool, y, array, m + 1, to, merge);
+	merge(pool, ret, x, y);
+	pool_push(pool, x);
+	pool_push(pool, y);
+}
+
+// Reduce `in` by the associative function `merge` over a balanced binary
+// tree and store the result in `ret`. Returns the height of the tree.
+//
+// The leaves are cut into a power of two of blocks of at most
+// `DIVIDE_CONQUER_BLOCK` integers, which are reduced in parallel. The
+// results of the blocks are then reduced level by level: level `k + 1`
+// holds the merges of the neighbours of level `k`. The merges of a level
+// are independent and run in parallel as well. Every thread but the first
+// one passes its own pool to `merge`. Like the halving of `prod` this keeps
+// both operands of a merge about the same size.
+//
+// The levels alternate between two buffers, so the integers of a level
+// are reused by the level after the next one. The input is never changed.
+size_t array_divide_conquer(mpz_pool *pool, mpz_t ret, mpz_array *in, dc_merge_func merge) {
+	size_t length = in->used, blocks, m, height = 0, i;
+	mpz_t *cur, *next, *t;
 
 	// At least two elements are required.
-	if (length < 2) {
+	if (length < 2)
 		return 0;
-	} else if (length == 2) {
-		// No bootstrap shortcut.
-		merge(pool, ret, in->array[0], in->array[1]);
-	} else {
-		// Bootstrap.
-		mpz_ui_pair_stack_init(&stack);
-		mpz_init_set(a, in->array[0]);
-		mpz_init_set(b, in->array[1]);
-		mpz_init(x);
-
-		// Start looping.
-		while (1) {
-			// Call the merge function.
-			merge(pool, x, a, b);
-
-			// Store the stack length and the n value of the top
-			// element in the stack.
-			stack_len = stack->size;
-			if (stack_len) mpz_ui_pair_stack_top_a(stack, &n_top);
-			// If the stack top is a left neighbor go up.
-			if(stack_len && n_top == n) {
-				mpz_ui_pair_stack_pop(stack, &n, a);
-				mpz_set(b, x);
-				n++;
-			// Else if we can jump down do it.
-			} else if(index + 1 < length) {
-				mpz_ui_pair_stack_push(stack, n, x);
-				n = 1;
-				mpz_set(a, in->array[index]);
-				mpz_set(b, in->array[index+1]);
-				index = index + 2;
-			// Jump right if only one leaf is left.
-			} else if(index < length) {
-				mpz_set(a, x);
-				mpz_set(b, in->array[index]);
-				index++;
-			// If we can't use the left neighbor, jump down or right
-			// jump up to the first element in the stack.
-			} else if (stack_len) {
-				mpz_ui_pair_stack_pop(stack, &n, a);
-				mpz_set(b, x);
-			// If the stack is empty and the index is at length stop.
-			} else if (stack_len == 0 && index == length) {
-				break;
-			// Should never happen.
-			} else {
-				printf("error in array_divide_conquer\n");
-				break;
+
+	for (i = 1; i < length && i < DIVIDE_CONQUER_BLOCK; i *= 2)
+		height++;
+	if (length <= DIVIDE_CONQUER_BLOCK) {
+		dc_block(pool, ret, in->array, 0, length - 1, merge);
+		return height;
+	}
+
+	for (blocks = 1; blocks * DIVIDE_CONQUER_BLOCK < length; blocks *= 2)
+		height++;
+	cur = (mpz_t *)malloc(blocks * sizeof(mpz_t));
+	next = (mpz_t *)malloc(blocks * sizeof(mpz_t));
+	for (i = 0; i < blocks; i++) {
+		mpz_init(cur[i]);
+		mpz_init(next[i]);
+	}
+	m = blocks;
+
+#if USE_OPENMP
+	#pragma omp parallel
+#endif
+	{
+#if USE_OPENMP
+		mpz_pool local;
+#endif
+		mpz_pool *p = pool;
+		size_t k;
+
+#if USE_OPENMP
+		if (omp_get_thread_num() != 0) {
+			pool_init(&local, 1);
+			p = &local;
+		}
+		#pragma omp for schedule(dynamic)
+#endif
+		for (k = 0; k < blocks; k++)
+			dc_block(p, cur[k], in->array, k * length / blocks, (k + 1) * length / blocks - 1, merge);
+
+		while (m > 1) {
+#if USE_OPENMP
+			#pragma omp for schedule(dynamic)
+#endif
+			for (k = 0; k < m / 2; k++)
+				merge(p, next[k], cur[2 * k], cur[2 * k + 1]);
+#if USE_OPENMP
+			#pragma omp single
+#endif
+			{
+				t = cur;
+				cur = next;
+				next = t;
+				m /= 2;
 			}
 		}
 
-		mpz_set(ret, x);
+#if USE_OPENMP
+		if (p != pool)
+			pool_clear(&local);
+#endif
+	}
+
+	// Copy instead of swapping, the limbs of the level buffers may come
+	// from an [arena](memory.html#arenas) scope which `ret` outlives.
+	mpz_set(ret, cur[0]);
+
+	for (i = 0; i < blocks; i++) {
+		mpz_clear(cur[i]);
+		mpz_clear(next[i]);
+	}
+	free(cur);
+	free(next);
+	return height;
+}
+
+// ### Reducing arrays of bases
+
+// The leaves are cut into about this count of subtrees, which are reduced
+// depth first by the thread which needs their base. Only the nodes above
+// get an entry in the node table, so a balanced tree of any size needs at
+// most 2 `DC_BASES_SUBTREES` nodes. Small trees are built down to the
+// leaves.
+#define DC_BASES_SUBTREES 4096
+
+// An inner node of the tree of `divide_conquer_bases` covers s[from..to]
+// and is split after `m`. `left` and `right` are the indices of the inner
+// child nodes or `DC_LEAF` if the child is a subtree of at most `block`
+// leaves. `pending` counts the inner children whose base
+// is not computed yet.
+#define DC_LEAF ((size_t)-1)
+
+typedef struct {
+	size_t from, to, m, parent, left, right;
+	int depth, pending;
+	mpz_array base;
+} dc_node;
+
+typedef struct {
+	dc_node *nodes;
+	mpz_t *s;
+	mpz_array *ret;
+	dc_split_func split;
+	dc_leaf_func leaf;
+	dc_base_merge_func merge;
+	size_t block, height;
+} dc_tree;
+
+static size_t dc_split(dc_tree *t, size_t from, size_t to) {
+	return t->split != NULL ? t->split(t->s, from, to) : to - (to - from) / 2 - 1;
+}
+
+// Reduce the subtree s[from..to] at `depth` depth first into `ret` and
+// return its height. The recursion is at most `block` deep.
+static size_t dc_subtree(dc_tree *t, mpz_pool *pool, mpz_array *ret, size_t from, size_t to, int depth) {
+	mpz_array p, q;
+	size_t m, hp, hq;
+
+	if (from == to) {
+		t->leaf(pool, ret, t->s, from);
+		return 0;
+	}
+	m = dc_split(t, from, to);
+	array_init(&p, m - from + 1);
+	hp = dc_subtree(t, pool, &p, from, m, depth + 1);
+	array_init(&q, to - m);
+	hq = dc_subtree(t, pool, &q, m + 1, to, depth + 1);
+	t->merge(pool, ret, &p, &q, t->s, from, to, depth);
+	array_clear(&p);
+	array_clear(&q);
+	return 1 + (hp > hq ? hp : hq);
+}
+
+// Take the base of a child s[from..to] of a node, either the computed base
+// of an inner node or the base of a small subtree.
+static void dc_child(dc_tree *t, mpz_pool *pool, mpz_array *ret, size_t child, size_t from, size_t to, int depth) {
+	size_t height;
+
+	if (child == DC_LEAF) {
+		array_init(ret, to - from + 1);
+		height = depth + dc_subtree(t, pool, ret, from, to, depth);
+#if USE_OPENMP
+		#pragma omp critical (dc_height)
+#endif
+		if (height > t->height)
+			t->height = height;
+	} else {
+		*ret = t->nodes[child].base;
+	}
+}
+
+// Merge the node `k` and then walk up the tree as long as this thread is
+// the last one to finish a child, so a merge runs as soon as both of its
+// children are done. The root merges straight into `ret`.
+static void dc_run(dc_tree *t, mpz_pool *pool, size_t k) {
+	dc_node *node;
+	mpz_array p, q, *out;
+	int pending;
+
+	while (1) {
+		node = &t->nodes[k];
+		dc_child(t, pool, &p, node->left, node->from, node->m, node->depth + 1);
+		dc_child(t, pool, &q, node->right, node->m + 1, node->to, node->depth + 1);
+		if (k == 0) {
+			out = t->ret;
+		} else {
+			out = &node->base;
+			array_init(out, node->to - node->from + 1);
+		}
+		t->merge(pool, out, &p, &q, t->s, node->from, node->to, node->depth);
+		array_clear(&p);
+		array_clear(&q);
+		if (k == 0)
+			return;
+
+		k = node->parent;
+#if USE_OPENMP
+		#pragma omp flush
+		#pragma omp atomic capture
+#endif
+		pending = --t->nodes[k].pending;
+#if USE_OPENMP
+		#pragma omp flush
+#endif
+		if (pending > 0)
+			return;
+	}
+}
+
+// Add a node for s[from..to] below `parent` to the table and push it on
+// the stack. Both grow with the table.
+static size_t dc_add(dc_tree *t, size_t *count, size_t *capacity, size_t **stack, size_t *top,
+size_t from, size_t to, size_t parent, int depth) {
+	size_t k = (*count)++;
+
+	if (k == *capacity) {
+		*capacity *= 2;
+		t->nodes = (dc_node *)realloc(t->nodes, *capacity * sizeof(dc_node));
+		*stack = (size_t *)realloc(*stack, *capacity * sizeof(size_t));
+		if (t->nodes == NULL || *stack == NULL) {
+			fprintf(stderr, "divide_conquer_bases: out of memory\n");
+			exit(1);
+		}
+	}
+	t->nodes[k].from = from;
+	t->nodes[k].to = to;
+	t->nodes[k].parent = parent;
+	t->nodes[k].depth = depth;
+	(*stack)[(*top)++] = k;
+	return k;
+}
+
+// Reduce the leaves `from..to` to a base and add it to `ret`. Every leaf is
+// turned into a base by `leaf`, neighbouring bases are merged by `merge` along the
+// tree given by `split` (the halves by count if `NULL`). Returns the height
+// of the tree.
+//
+// The nodes of the tree above the subtrees of at most `block` leaves are
+// built up front with an explicit stack instead of recursion, so a
+// degenerated split cannot overflow the call stack, the recursion of a
+// subtree is at most `block` deep. All nodes whose children are subtrees
+// are then shared among a fixed team of threads. A thread which completes the second child of a node merges that
+// node next, the tree is reduced bottom up without waiting for whole levels
+// and without nested parallel regions. Every thread but the first one
+// passes its own pool to `leaf` and `merge`.
+size_t divide_conquer_bases(mpz_pool *pool, mpz_array *ret, mpz_t *s, size_t from, size_t to,
+dc_split_func split, dc_leaf_func leaf, dc_base_merge_func merge) {
+	size_t count = 0, capacity, top = 0, ready = 0, k, c;
+	size_t *stack, *starts;
+	dc_node *node;
+	dc_tree t;
+
+	t.s = s;
+	t.ret = ret;
+	t.split = split;
+	t.leaf = leaf;
+	t.merge = merge;
+	t.block = (to - from + 1) / DC_BASES_SUBTREES;
+	t.height = 0;
+	if (t.block < 1)
+		t.block = 1;
+	if (to - from + 1 <= t.block)
+		return dc_subtree(&t, pool, ret, from, to, 0);
+
+	capacity = 2 * (to - from + 1) / t.block;
+	t.nodes = (dc_node *)malloc(capacity * sizeof(dc_node));
+	stack = (size_t *)malloc(capacity * sizeof(size_t));
+	if (t.nodes == NULL || stack == NULL) {
+		fprintf(stderr, "divide_conquer_bases: out of memory\n");
+		exit(1);
+	}
+
+	dc_add(&t, &count, &capacity, &stack, &top, from, to, DC_LEAF, 0);
+	while (top > 0) {
+		k = stack[--top];
+		node = &t.nodes[k];
+		node->m = dc_split(&t, node->from, node->to);
+		node->left = node->right = DC_LEAF;
+		node->pending = 0;
+		if ((size_t)node->depth + 1 > t.height)
+			t.height = node->depth + 1;
+
+		// `dc_add` may move the table.
+		if (node->to - node->m > t.block) {
+			c = dc_add(&t, &count, &capacity, &stack, &top, node->m + 1, node->to, k, node->depth + 1);
+			node = &t.nodes[k];
+			node->right = c;
+			node->pending++;
+		}
+		if (node->m + 1 - node->from > t.block) {
+			c = dc_add(&t, &count, &capacity, &stack, &top, node->from, node->m, k, node->depth + 1);
+			node = &t.nodes[k];
+			node->left = c;
+			node->pending++;
+		}
+	}
+
+	// Walk the table depth first again, so the nodes which can be merged
+	// right away are taken left to right.
+	starts = (size_t *)malloc(count * sizeof(size_t));
+	if (starts == NULL) {
+		fprintf(stderr, "divide_conquer_bases: out of memory\n");
+		exit(1);
+	}
+	stack[top++] = 0;
+	while (top > 0) {
+		k = stack[--top];
+		node = &t.nodes[k];
+		if (node->pending == 0)
+			starts[ready++] = k;
+		if (node->right != DC_LEAF)
+			stack[top++] = node->right;
+		if (node->left != DC_LEAF)
+			stack[top++] = node->left;
+	}
+	free(stack);
+
+#if USE_OPENMP
+	#pragma omp parallel
+#endif
+	{
+#if USE_OPENMP
+		mpz_pool local;
+#endif
+		mpz_pool *p = pool;
+		size_t j;
+
+#if USE_OPENMP
+		if (omp_get_thread_num() != 0) {
+			pool_init(&local, 0);
+			p = &local;
+		}
+		#pragma omp for schedule(dynamic)
+#endif
+		for (j = 0; j < ready; j++)
+			dc_run(&t, p, starts[j]);
 
-		mpz_clear(a);
-		mpz_clear(b);
-		mpz_clear(x);
-		mpz_ui_pair_stack_clear(stack);
+#if USE_OPENMP
+		if (p != pool)
+			pool_clear(&local);
+#endif
 	}
 
-	return n;
+	free(starts);
+	free(t.nodes);
+	return t.height;
 }
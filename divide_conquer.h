@@ -12,6 +12,21 @@
 #include "array.h"
 #include "pool.h"
 
+// The leaves are reduced in blocks of this count by one thread each.
+#define DIVIDE_CONQUER_BLOCK 64
+
 size_t array_divide_conquer(mpz_pool *pool, mpz_t ret, mpz_array *in, void(*merge)(mpz_pool *, mpz_t, const mpz_t, const mpz_t));
 
+// Callbacks of `divide_conquer_bases`: `dc_split_func` returns the last
+// index of the left half of s[from..to], `dc_leaf_func` adds the base of
+// the leaf `i` to `ret` and `dc_base_merge_func` adds the merge of the
+// bases `p` and `q` of the halves of s[from..to] at tree depth `depth`.
+// `s` is only passed through, it may be `NULL` if the callbacks do not
+// need it.
+typedef size_t (*dc_split_func)(mpz_t *s, size_t from, size_t to);
+typedef void (*dc_leaf_func)(mpz_pool *pool, mpz_array *ret, mpz_t *s, size_t i);
+typedef void (*dc_base_merge_func)(mpz_pool *pool, mpz_array *ret, mpz_array *p, mpz_array *q, mpz_t *s, size_t from, size_t to, int depth);
+
+size_t divide_conquer_bases(mpz_pool *pool, mpz_array *ret, mpz_t *s, size_t from, size_t to, dc_split_func split, dc_leaf_func leaf, dc_base_merge_func merge);
+
 #endif /* DIVIDE_CONQUER_H_ */
@@ -0,0 +1,213 @@
+// copri, Attacking RSA by factoring coprimes
+//
+// License: GNU Lesser General Public License (LGPL), version 3 or later
+// See the lgpl.txt file in the root directory or <https://www.gnu.org/licenses/lgpl>.
+
+// Sorting of raw GMP streams larger than the memory.
+//
+// The integers are read in runs up to a memory budget. Every run is sorted
+// by `array_msort` and spilled to a temporary file in raw GMP format. The
+// runs are merged by a heap of their smallest integers while the output is
+// written.
+//
+// See [extsort test](test-extsort.html) for basic usage.
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <gmp.h>
+#include "extsort.h"
+
+#define MIN(a,b) (((a)<(b))?(a):(b))
+
+// Bytes per integer of a run besides its limbs: the `mpz_t` of the array
+// and the sort keys, merge buffer and permutation of `array_msort`.
+#define EXTSORT_OVERHEAD 80
+
+// The sorted run of a merge and its smallest integer not written yet.
+typedef struct {
+	mpz_t head;
+	FILE *in;
+} extsort_run;
+
+// Create a temporary file in `$TMPDIR` or `/tmp`. The file is unlinked
+// right away, so it is removed when it is closed.
+FILE *extsort_tmpfile(void) {
+	const char *dir = getenv("TMPDIR");
+	char name[4096];
+	FILE *f;
+	int fd;
+
+	snprintf(name, sizeof(name), "%s/copri-XXXXXX", dir != NULL ? dir : "/tmp");
+	fd = mkstemp(name);
+	if (fd < 0) {
+		fprintf(stderr, "Can't create a temporary file in %s\n", dir != NULL ? dir : "/tmp");
+		return NULL;
+	}
+	unlink(name);
+	f = fdopen(fd, "w+");
+	if (f == NULL)
+		close(fd);
+	return f;
+}
+
+// Write the sorted array, with `unique` equal neighbours are written once.
+// `out` may be `NULL` to only count the integers.
+static size_t extsort_write(mpz_array *a, FILE *out, int unique) {
+	size_t i, count = 0;
+
+	for (i = 0; i < a->used; i++) {
+		if (unique && i > 0 && mpz_cmp(a->array[i - 1], a->array[i]) == 0)
+			continue;
+		if (out != NULL)
+			mpz_out_raw(out, a->array[i]);
+		count++;
+	}
+	return count;
+}
+
+// Move the run at `i` down to its place in the heap.
+static void extsort_sift(extsort_run **heap, size_t n, size_t i) {
+	extsort_run *t;
+	size_t c;
+
+	while ((c = 2 * i + 1) < n) {
+		if (c + 1 < n && mpz_cmp(heap[c + 1]->head, heap[c]->head) < 0)
+			c++;
+		if (mpz_cmp(heap[i]->head, heap[c]->head) <= 0)
+			break;
+		t = heap[i];
+		heap[i] = heap[c];
+		heap[c] = t;
+		i = c;
+	}
+}
+
+// Merge `n` sorted runs into `out` and return the number of integers
+// written. The runs are read from their beginning.
+static size_t extsort_merge(FILE **runs, size_t n, FILE *out, int unique) {
+	extsort_run *r = (extsort_run *)malloc(n * sizeof(extsort_run));
+	extsort_run **heap = (extsort_run **)malloc(n * sizeof(extsort_run *));
+	size_t i, size = 0, count = 0;
+	mpz_t last;
+	int have_last = 0;
+
+	mpz_init(last);
+	for (i = 0; i < n; i++) {
+		mpz_init(r[i].head);
+		r[i].in = runs[i];
+		rewind(runs[i]);
+		if (mpz_inp_raw(r[i].head, r[i].in) > 0)
+			heap[size++] = &r[i];
+	}
+	for (i = size; i > 0; i--)
+		extsort_sift(heap, size, i - 1);
+
+	while (size > 0) {
+		if (!unique || !have_last || mpz_cmp(last, heap[0]->head) != 0) {
+			if (out != NULL)
+				mpz_out_raw(out, heap[0]->head);
+			count++;
+		}
+		// Keep the written integer to skip its duplicates.
+		if (unique) {
+			mpz_swap(last, heap[0]->head);
+			have_last = 1;
+		}
+		if (mpz_inp_raw(heap[0]->head, heap[0]->in) == 0)
+			heap[0] = heap[--size];
+		extsort_sift(heap, size, 0);
+	}
+
+	for (i = 0; i < n; i++)
+		mpz_clear(r[i].head);
+	mpz_clear(last);
+	free(heap);
+	free(r);
+	return count;
+}
+
+// Close `n` runs.
+static void extsort_close(FILE **runs, size_t n) {
+	size_t i;
+	for (i = 0; i < n; i++)
+		fclose(runs[i]);
+}
+
+// ## sort a stream
+//
+// Sort the raw GMP stream `in` into `out` and keep the integers of a run
+// below `budget` bytes. With `unique` every integer is written only once.
+// `out` may be `NULL` to only count the integers. The number of integers
+// read is stored in `count`, the number written is returned.
+size_t array_extsort(FILE *in, FILE *out, size_t budget, int unique, size_t *count) {
+	mpz_array run;
+	FILE **runs = NULL, *f;
+	size_t n = 0, size = 0, bytes = 0, total = 0, written = 0, i, k, m;
+	mpz_t buf;
+	int eof = 0;
+
+	array_init(&run, 1024);
+	mpz_init(buf);
+	while (!eof) {
+		bytes = 0;
+		while (bytes < budget) {
+			if (mpz_inp_raw(buf, in) == 0) {
+				eof = 1;
+				break;
+			}
+			array_add(&run, buf);
+			bytes += mpz_size(buf) * sizeof(mp_limb_t) + EXTSORT_OVERHEAD;
+		}
+		if (run.used == 0)
+			break;
+		total += run.used;
+		array_msort(&run);
+
+		// A single run is written without spilling.
+		if (eof && n == 0) {
+			written = extsort_write(&run, out, unique);
+			break;
+		}
+
+		if ((f = extsort_tmpfile()) == NULL) {
+			extsort_close(runs, n);
+			n = 0;
+			break;
+		}
+		extsort_write(&run, f, unique);
+		if (n == size) {
+			size = size ? 2 * size : 16;
+			runs = (FILE **)realloc(runs, size * sizeof(FILE *));
+		}
+		runs[n++] = f;
+		array_clear(&run);
+		array_init(&run, 1024);
+	}
+	mpz_clear(buf);
+	array_clear(&run);
+
+	// Merge groups of runs until one merge is left.
+	while (n > EXTSORT_MAX_RUNS) {
+		for (i = 0, k = 0; i < n; i += EXTSORT_MAX_RUNS, k++) {
+			m = MIN(EXTSORT_MAX_RUNS, n - i);
+			if ((f = extsort_tmpfile()) == NULL) {
+				extsort_close(runs, k);
+				extsort_close(runs + i, n - i);
+				break;
+			}
+			extsort_merge(runs + i, m, f, unique);
+			extsort_close(runs + i, m);
+			runs[k] = f;
+		}
+		n = i < n ? 0 : k;
+	}
+	if (n > 0) {
+		written = extsort_merge(runs, n, out, unique);
+		extsort_close(runs, n);
+	}
+	free(runs);
+
+	if (count != NULL)
+		*count = total;
+	return written;
+}
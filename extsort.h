@@ -0,0 +1,20 @@
+// copri, Attacking RSA by factoring coprimes
+//
+// License: GNU Lesser General Public License (LGPL), version 3 or later
+// See the lgpl.txt file in the root directory or <https://www.gnu.org/licenses/lgpl>.
+
+#ifndef EXTSORT_H
+#define EXTSORT_H
+
+#include <stdio.h>
+#include <gmp.h>
+#include "array.h"
+
+// The most runs merged at once, more runs are merged in several passes.
+#define EXTSORT_MAX_RUNS 256
+
+FILE *extsort_tmpfile(void);
+
+size_t array_extsort(FILE *in, FILE *out, size_t budget, int unique, size_t *count);
+
+#endif /* EXTSORT_H */
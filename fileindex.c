@@ -0,0 +1,258 @@
+// copri, Attacking RSA by factoring coprimes
+//
+// License: GNU Lesser General Public License (LGPL), version 3 or later
+// See the lgpl.txt file in the root directory or <https://www.gnu.org/licenses/lgpl>.
+
+// Random access to raw GMP files by an index sidecar.
+//
+// The raw format of `mpz_out_raw` has no index, every reader has to parse
+// the file from its beginning. The sidecar `file.idx` stores the offset of
+// every integer of `file`:
+//
+//     8 bytes   magic "CPRIDX2\0"
+//     8 bytes   count of integers
+//     8 bytes   size of the indexed file
+//     8 bytes   modification time of the indexed file in nanoseconds
+//     8 bytes   offset of every integer
+//
+// All numbers are unsigned little endian. The sidecar is mapped into memory,
+// so integer `i` is found in O(1) without reading the other offsets. It is
+// only used while size and modification time of the file match.
+//
+// See [fileindex test](test-fileindex.html) for basic usage.
+#define _FILE_OFFSET_BITS 64
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <gmp.h>
+#include "fileindex.h"
+#include "config.h"
+#if USE_OPENMP
+#include <omp.h>
+#endif
+
+#define FILEINDEX_HEADER 32
+
+static void put_le64(unsigned char *p, uint64_t v) {
+	int i;
+	for (i = 0; i < 8; i++)
+		p[i] = (unsigned char)(v >> (8 * i));
+}
+
+static uint64_t get_le64(const unsigned char *p) {
+	uint64_t v = 0;
+	int i;
+	for (i = 7; i >= 0; i--)
+		v = (v << 8) | p[i];
+	return v;
+}
+
+// The modification time of a file in nanoseconds.
+static uint64_t fileindex_mtime(const struct stat *st) {
+	return (uint64_t)st->st_mtim.tv_sec * 1000000000 + (uint64_t)st->st_mtim.tv_nsec;
+}
+
+// The name of the sidecar, has to be freed.
+static char * fileindex_name(const char *filename) {
+	char *name = (char *)malloc(strlen(filename) + strlen(FILEINDEX_SUFFIX) + 1);
+	strcpy(name, filename);
+	strcat(name, FILEINDEX_SUFFIX);
+	return name;
+}
+
+// ## build the index
+//
+// Scan `filename` by the size headers of its integers and write the
+// sidecar. Returns the number of indexed integers, 0 if the file can't be
+// read or has a truncated integer.
+size_t fileindex_build(const char *filename) {
+	FILE *in, *out;
+	struct stat st;
+	char *name;
+	unsigned char h[8];
+	uint64_t offset = 0, count = 0;
+	long n;
+
+	if ((in = fopen(filename, "r")) == NULL)
+		return 0;
+	if (fstat(fileno(in), &st) != 0) {
+		fclose(in);
+		return 0;
+	}
+	name = fileindex_name(filename);
+	if ((out = fopen(name, "w")) == NULL) {
+		fprintf(stderr, "Can't write %s\n", name);
+		free(name);
+		fclose(in);
+		return 0;
+	}
+
+	// The header is written again with the count at the end.
+	memset(h, 0, 8);
+	fwrite(h, 1, 8, out);
+	fwrite(h, 1, 8, out);
+	fwrite(h, 1, 8, out);
+	fwrite(h, 1, 8, out);
+	while (fread(h, 1, 4, in) == 4) {
+		n = (long)(int)(((unsigned)h[0] << 24) | ((unsigned)h[1] << 16) | ((unsigned)h[2] << 8) | h[3]);
+		if (n < 0) n = -n;
+		if (fseeko(in, (off_t)n, SEEK_CUR) != 0)
+			break;
+		put_le64(h, offset);
+		fwrite(h, 1, 8, out);
+		offset += 4 + (uint64_t)n;
+		count++;
+	}
+	// The offsets have to end at the end of the file, otherwise the last
+	// integer is truncated.
+	if (fseeko(in, 0, SEEK_END) != 0 || ftello(in) != (off_t)offset) {
+		fprintf(stderr, "%s is truncated after %llu integers\n", filename, (unsigned long long)count);
+		count = 0;
+	}
+
+	rewind(out);
+	fwrite(FILEINDEX_MAGIC, 1, 8, out);
+	put_le64(h, count);
+	fwrite(h, 1, 8, out);
+	put_le64(h, offset);
+	fwrite(h, 1, 8, out);
+	put_le64(h, fileindex_mtime(&st));
+	fwrite(h, 1, 8, out);
+	fclose(out);
+	fclose(in);
+	if (count == 0)
+		unlink(name);
+	free(name);
+	return (size_t)count;
+}
+
+// ## open the index
+//
+// Open `filename` and map its sidecar. Returns 0 if there is no sidecar or
+// if it doesn't match the file: a file rewritten with the same size still
+// has a different modification time.
+int fileindex_open(file_index *x, const char *filename) {
+	struct stat st;
+	char *name = fileindex_name(filename);
+	void *map;
+	int fd;
+
+	memset(x, 0, sizeof(file_index));
+	fd = open(name, O_RDONLY);
+	free(name);
+	if (fd < 0)
+		return 0;
+	if (fstat(fd, &st) != 0 || st.st_size < FILEINDEX_HEADER) {
+		close(fd);
+		return 0;
+	}
+	map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return 0;
+	x->map = (const unsigned char *)map;
+	x->map_size = (size_t)st.st_size;
+	x->count = (size_t)get_le64(x->map + 8);
+	x->filename = filename;
+
+	if (memcmp(x->map, FILEINDEX_MAGIC, 8) != 0 ||
+		x->map_size != FILEINDEX_HEADER + 8 * x->count ||
+		stat(filename, &st) != 0 || (uint64_t)st.st_size != get_le64(x->map + 16) ||
+		fileindex_mtime(&st) != get_le64(x->map + 24) ||
+		(x->data = fopen(filename, "r")) == NULL) {
+		fprintf(stderr, "The index of %s is stale, rebuild it\n", filename);
+		fileindex_close(x);
+		return 0;
+	}
+	return 1;
+}
+
+void fileindex_close(file_index *x) {
+	if (x->map != NULL)
+		munmap((void *)x->map, x->map_size);
+	if (x->data != NULL)
+		fclose(x->data);
+	memset(x, 0, sizeof(file_index));
+}
+
+// The offset of integer `i` in the file.
+uint64_t fileindex_offset(file_index *x, size_t i) {
+	return get_le64(x->map + FILEINDEX_HEADER + 8 * i);
+}
+
+// Grow `a` by `n` initialized integers and return the first of them.
+static mpz_t * fileindex_grow(mpz_array *a, size_t n) {
+	size_t i;
+
+	if (a->size < a->used + n) {
+		a->size = a->used + n;
+		a->array = (mpz_t *)realloc(a->array, a->size * sizeof(mpz_t));
+	}
+	for (i = 0; i < n; i++)
+		mpz_init(a->array[a->used + i]);
+	a->used += n;
+	return a->array + a->used - n;
+}
+
+// ## read integers
+//
+// Add `count` integers starting at integer `from` to `a`. Large ranges are
+// read in parallel, each thread reads its part by its own stream. Returns
+// the number of integers read.
+size_t fileindex_read(file_index *x, mpz_array *a, size_t from, size_t count) {
+	mpz_t *dst;
+	size_t parts = 1, width, p, read = 0;
+
+	if (from >= x->count)
+		return 0;
+	if (count > x->count - from)
+		count = x->count - from;
+	if (count == 0)
+		return 0;
+	dst = fileindex_grow(a, count);
+
+#if USE_OPENMP
+	if (count >= FILEINDEX_PARALLEL_SIZE)
+		parts = omp_get_max_threads();
+#endif
+	width = (count + parts - 1) / parts;
+#if USE_OPENMP
+	#pragma omp parallel for schedule(static) reduction(+:read)
+#endif
+	for (p = 0; p < parts; p++) {
+		size_t i, first = p * width, last = first + width < count ? first + width : count;
+		FILE *in;
+		if (first >= last)
+			continue;
+		in = parts > 1 ? fopen(x->filename, "r") : x->data;
+		if (in == NULL)
+			continue;
+		if (fseeko(in, (off_t)fileindex_offset(x, from + first), SEEK_SET) == 0) {
+			for (i = first; i < last && mpz_inp_raw(dst[i], in) > 0; i++)
+				read++;
+		}
+		if (in != x->data)
+			fclose(in);
+	}
+	return read;
+}
+
+// Add the integers at `indices` to `a` in the given order. Returns the
+// number of integers read.
+size_t fileindex_read_indices(file_index *x, mpz_array *a, const size_t *indices, size_t n) {
+	mpz_t *dst = fileindex_grow(a, n);
+	size_t i, read = 0;
+
+	for (i = 0; i < n; i++) {
+		if (indices[i] < x->count &&
+			fseeko(x->data, (off_t)fileindex_offset(x, indices[i]), SEEK_SET) == 0 &&
+			mpz_inp_raw(dst[i], x->data) > 0)
+			read++;
+	}
+	return read;
+}
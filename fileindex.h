@@ -0,0 +1,42 @@
+// copri, Attacking RSA by factoring coprimes
+//
+// License: GNU Lesser General Public License (LGPL), version 3 or later
+// See the lgpl.txt file in the root directory or <https://www.gnu.org/licenses/lgpl>.
+
+#ifndef FILEINDEX_H
+#define FILEINDEX_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <gmp.h>
+#include "array.h"
+
+// The sidecar of `file` is `file` with this suffix.
+#define FILEINDEX_SUFFIX ".idx"
+
+#define FILEINDEX_MAGIC "CPRIDX2"
+
+// Below this count a range is read by a single thread.
+#define FILEINDEX_PARALLEL_SIZE 4096
+
+typedef struct {
+	const char *filename;
+	FILE *data;
+	const unsigned char *map;
+	size_t map_size;
+	size_t count;
+} file_index;
+
+size_t fileindex_build(const char *filename);
+
+int fileindex_open(file_index *x, const char *filename);
+
+void fileindex_close(file_index *x);
+
+uint64_t fileindex_offset(file_index *x, size_t i);
+
+size_t fileindex_read(file_index *x, mpz_array *a, size_t from, size_t count);
+
+size_t fileindex_read_indices(file_index *x, mpz_array *a, const size_t *indices, size_t n);
+
+#endif /* FILEINDEX_H */
@@ -6,32 +6,61 @@
 // This file contains a balanced split util application
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <unistd.h>
 #include <gmp.h>
 #include "copri.h"
-
-#define PRODUCT_1000PRIMES "678629608419755514953266004896957820972161078160377361970324401521111792080121479864721936071815069425907219215791646774510151130705671056416094404541167439287735488353736963531288441938981088407654256240451529081607242659988552012480001287133802278572298314458227654950008738955663072953766341488209509227159933381319371567666804963833249523370831655778314080604712246344649628072459805028063160913071005795183295590443375991860551286230065601580359306757988823124262933259305966372664091680948986620887898883461227980556352852601733860114246410887151983493540958775872577571329277597701163671587052591794386970584444752423596023268793021595936555282977008138833858707329536639661377014042325817639809356799596347944462538427778375525904007169834445567450156949173690701738594584875536885957881452438269676946038980597530032671949818526703398270502591574889228837327819994695664173214894557366363343168494592437205324652573516528943874382178600874878024643322031797588414862315122048846223291257900756812820806739795819803783834366449110996030165071920678407750230118672657378102915524688059208755108467225277065866103666795739208709483959119145497860116133180335757702319385020561042517429031288526721801002679092058170909635701703382390753126302005323612316630558515594616479515096004453718500060291836932140612551722161051067379805065002788004096547708243964735215852734827632098700684466036892770059458754742495711074949314613079781545359495019757827538184361308856825999513366660884541936335491466045305322353749545362962683762333460252556042583248154845846566948014188971651057314058851019340282646752239847232045463969939303431371658607220786663205842510175297602195433569758123945251755043878718459161595137019904240640962465899496512410906852088532419874383895656303779315512987369934711061777117329635461569528504994783413643047392160871963795694958724055597996525917454740621526108635321204763824742430011606570436994644169759611263012712375861911682673548369764923418748711813157811279361700331599397588282864147719911156923709896847720603482450047076226728760035577410722701184878333100234780537897462936378382079055966277885316116887834607362114802378706815302650083359076798475953780285866955566883261644281750278358349579977889429105626865087038835977930842352223971442123281019745568694318200865586150762549114357677130353514342849892002965601064686292493671204318349298134598116662388818407027989992498970986262856712232401426575229549744739851333516937170071337085705197690437625282926914858257689908846227286051735284322402597283976180484905838486513162987381659809287870592690902387482033879184700359561190209417618607868793293476867624464497838299321267571049753373623085351455438610076341961842557148160442782839736179329056237366708383637405663196770746783100179128651460773512143616414356080816160456447832856222804164147618891013658880373227849181446498052320436905124576367614898030410445386643656246089772967461562154147355201124738052009172637452710027640262529821855681129322547617443299372089380860873141895162966481252930360380537684913059090577224188204179681342669502124011214018434733385892140553307905100266308832521127607403573729242486985024795253305646999864066282626291530104297235324933472771821035277094700384260778312268190937365143307612108901729316774669077441981239149913617114331308200242717771235228048768133852203532299832810943137983635951570"
+#include "primes.h"
+#include "config.h"
+#if USE_OPENMP
+#include <omp.h>
+#endif
+
+// Keys with a prime factor below the bound are bad. The default bound
+// keeps the first 1000 primes.
+//
+// The keys are streamed in blocks of `-n` keys, so only one block is kept
+// in memory. The screening blocks of a block are classified in parallel and
+// the keys are written in their original order.
+#define FILTER_BLOCK_SIZE 262144
+
+// Write a key to `out` if it is open.
+static int write_key(FILE *out, const mpz_t key) {
+  if (out == NULL) return 1;
+  return mpz_out_raw(out, key) > 0;
+}
 
 // The generic `main` function.
 //
 // Define all variables at the beginning to make the C99 compiler
 // happy.
 int main(int argc, char **argv) {
-  mpz_array s, good, bad;
-  size_t count, i, wc;
-  int c, vflg = 0, jflg = 0, hflg = 0, errflg = 0;
+  mpz_array s, primes;
+  mpz_pool pool, *pools;
+  size_t count, i, k, chunks, good = 0, bad = 0, block = FILTER_BLOCK_SIZE;
+  int c, t, vflg = 0, jflg = 0, hflg = 0, errflg = 0, threads = 1;
   char *filename = "primes.lst";
   char *out_good_filename = NULL;
   char *out_bad_filename = NULL;
-  mpz_t product, gcd;
-  double percentage;
-
-  mpf_set_default_prec(64);
+  char *flags;
+  unsigned long bound = PRIMES_DEFAULT_BOUND;
+  long int n;
+  FILE *in, *out_good = NULL, *out_bad = NULL;
+  mpz_t product;
 
   // #### argument parsing
   // Boring `getopt` argument parsing.
-  while ((c = getopt(argc, argv, ":vhjb:g:")) != -1) {
+  while ((c = getopt(argc, argv, ":vhjb:g:p:n:")) != -1) {
     switch(c) {
+    case 'n':
+      n = strtol(optarg, NULL, 0);
+      if (n < 1) errflg++;
+      else block = (size_t)n;
+      break;
+    case 'p':
+      bound = strtoul(optarg, NULL, 0);
+      if (bound < 3) errflg++;
+      break;
     case 'b':
       out_bad_filename = optarg;
       break;
@@ -65,22 +94,29 @@ int main(int argc, char **argv) {
 
   // Print the usage and exit if an error occurred during argument parsing.
   if (errflg || hflg > 0) {
-    fprintf(stderr, "usage: [-v] [-o FILE] [file]\n"\
+    fprintf(stderr, "usage: [-v] [-b FILE] [-g FILE] [-p BOUND] [-n COUNT] [file]\n"\
                     "\n\t-b FILE   to store the bad keys"\
-                    "\n\t-g FILE   to store the bod keys"\
+                    "\n\t-g FILE   to store the good keys"\
+                    "\n\t-p BOUND  filter keys with a prime factor below BOUND (default 7920)"\
+                    "\n\t-n COUNT  read the keys in blocks of COUNT (default 262144)"\
                     "\n\t-j        print json messages"\
                     "\n\t-v        be more verbose"\
                     "\n\n");
     exit(2);
   }
 
-  // Load the integers.
-  array_init(&s, 10);
-  count = array_of_file(&s, filename);
-  if (count == 0) {
+  // Read the first block.
+  if (strcmp(filename, "-") == 0) {
+    in = stdin;
+  } else {
+    in = fopen(filename, "r");
+  }
+  if (in == NULL) {
     fprintf(stderr, "Can't load %s\n", filename);
     return 1;
   }
+  array_init(&s, block);
+  count = array_read_stdio(&s, in, block);
   if (s.used != count) {
     fprintf(stderr, "Array size and load count do not match\n");
     return 2;
@@ -90,60 +126,119 @@ int main(int argc, char **argv) {
     return 3;
   }
 
-  if (out_bad_filename != NULL && vflg > 0) {
-    printf("bad keys are going to be saved in '%s'\n", out_bad_filename);
+  // The outputs are appended like by `array_to_file`.
+  if (out_bad_filename != NULL) {
+    if (vflg > 0)
+      printf("bad keys are going to be saved in '%s'\n", out_bad_filename);
+    out_bad = strcmp(out_bad_filename, "-") == 0 ? stdout : fopen(out_bad_filename, "a+");
   }
-
-  if (out_good_filename != NULL && vflg > 0) {
-    printf("good keys are going to be saved in '%s'\n", out_good_filename);
+  if (out_good_filename != NULL) {
+    if (vflg > 0)
+      printf("good keys are going to be saved in '%s'\n", out_good_filename);
+    out_good = strcmp(out_good_filename, "-") == 0 ? stdout : fopen(out_good_filename, "a+");
+  }
+  if ((out_bad_filename != NULL && out_bad == NULL) ||
+      (out_good_filename != NULL && out_good == NULL)) {
+    fprintf(stderr, "Can't open the output files\n");
+    return 4;
   }
 
+  // Sieve the primes below the bound and compute their product by a
+  // product tree.
+  pool_init(&pool, 0);
+  array_init(&primes, 1024);
+  primes_sieve(&primes, bound);
   mpz_init(product);
-  mpz_set_str(product, PRODUCT_1000PRIMES, 10);
-
+  array_prod(&pool, &primes, product);
   if (vflg) {
-    printf("filter %zu integers\n", s.used);
+    printf("product of %zu primes below %lu has %zu bits\n", primes.used, bound, mpz_sizeinbase(product, 2));
+  }
+  array_clear(&primes);
+  pool_clear(&pool);
+
+#if USE_OPENMP
+  threads = omp_get_max_threads();
+#endif
+  pools = (mpz_pool *)malloc(threads * sizeof(mpz_pool));
+  for (t = 0; t < threads; t++) {
+    pool_init(&pools[t], 64);
   }
+  flags = (char *)malloc(block);
+
+  while (count > 0) {
+    // Reduce the product modulo every key by a remainder tree, a key is bad
+    // if gcd(product mod key, key) != 1 (see [screen](copri.html#screening-a-set-by-a-product)).
+    // Keys ≤ 1 are bad without screening, there is no remainder modulo 0.
+    chunks = (count + SCREEN_BLOCK_SIZE - 1) / SCREEN_BLOCK_SIZE;
+#if USE_OPENMP
+    #pragma omp parallel for schedule(dynamic)
+#endif
+    for (k = 0; k < chunks; k++) {
+      mpz_array g, h;
+      mpz_t *keys;
+      size_t j, m, small = 0, from = k * SCREEN_BLOCK_SIZE;
+      size_t to = from + SCREEN_BLOCK_SIZE < count ? from + SCREEN_BLOCK_SIZE - 1 : count - 1;
+#if USE_OPENMP
+      mpz_pool *p = &pools[omp_get_thread_num()];
+#else
+      mpz_pool *p = &pools[0];
+#endif
+      for (j = from; j <= to; j++) {
+        flags[j] = mpz_cmp_ui(s.array[j], 1) <= 0;
+        small += flags[j];
+      }
+      // Only a block with such keys is copied.
+      keys = s.array + from;
+      array_init(&h, small > 0 ? to - from + 1 - small : 1);
+      if (small > 0) {
+        for (j = from; j <= to; j++) {
+          if (!flags[j]) array_add(&h, s.array[j]);
+        }
+        keys = h.array;
+      }
+      array_init(&g, to - from + 1);
+      if (small < to - from + 1) {
+        screen(p, &g, product, keys, 0, to - from - small);
+      }
+      for (j = from, m = 0; j <= to; j++) {
+        if (!flags[j]) flags[j] = mpz_cmp_ui(g.array[m++], 1) != 0;
+      }
+      array_clear(&g);
+      array_clear(&h);
+    }
 
-  mpz_init(gcd);
-  array_init(&good, 10);
-  array_init(&bad, 10);
-  for(i=0; i<s.used; i++) {
-    if (vflg && i % 10000 == 0) {
-      percentage = ((double) i) / ((double) s.used) * 100.0;
-      printf("%.2f%% (%zu of %zu)\n", percentage, i, s.used);
+    // Write the block in order.
+    for (i = 0; i < count; i++) {
+      if (!write_key(flags[i] ? out_bad : out_good, s.array[i])) {
+        fprintf(stderr, "Array size and write count do not match\n");
+        return 4;
+      }
+      if (flags[i]) bad++;
+      else good++;
     }
-    mpz_gcd(gcd, s.array[i], product);
-    if (mpz_cmp_ui(gcd, 1) != 0) {
-      array_add(&bad, s.array[i]);
-    } else {
-      array_add(&good, s.array[i]);
+    if (vflg) {
+      printf("filtered %zu integers\n", good + bad);
     }
+
+    array_clear(&s);
+    array_init(&s, block);
+    count = array_read_stdio(&s, in, block);
   }
 
   if (vflg) {
-    printf("found %zu bad and %zu good integers\n", bad.used, good.used);
+    printf("found %zu bad and %zu good integers\n", bad, good);
   }
 
-  if (out_good_filename != NULL) {
-    wc = array_to_file(&good, out_good_filename);
-    if (good.used != wc) {
-      fprintf(stderr, "Array size and write count do not match\n");
-      return 4;
-    }
-  }
+  if (in != stdin) fclose(in);
+  if (out_bad != NULL && out_bad != stdout) fclose(out_bad);
+  if (out_good != NULL && out_good != stdout) fclose(out_good);
 
-  if (out_bad_filename != NULL) {
-    wc = array_to_file(&bad, out_bad_filename);
-    if (bad.used != wc) {
-      fprintf(stderr, "Array size and write count do not match\n");
-      return 4;
-    }
+  for (t = 0; t < threads; t++) {
+    pool_clear(&pools[t]);
   }
-
-  array_clear(&bad);
-  array_clear(&good);
+  free(pools);
+  free(flags);
   array_clear(&s);
   mpz_clear(product);
-  mpz_clear(gcd);
+  return 0;
 }
@@ -3,23 +3,48 @@
 // License: GNU Lesser General Public License (LGPL), version 3 or later
 // See the lgpl.txt file in the root directory or <https://www.gnu.org/licenses/lgpl>.
 
-// Generate openssl rsa keys and append it as gmp mpz binary integers to a file.
-#include <openssl/rsa.h>
-#include <openssl/sha.h>
+// Generate rsa keys and append it as gmp mpz binary integers to a file.
+//
+// The keys are generated by openssl or, with `-g`, by GMP. The GMP mode
+// builds benchmark corpora: it runs in parallel, is deterministic from its
+// seed and plants clusters of keys sharing a prime and duplicate keys.
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <unistd.h>
 #include <gmp.h>
+#include "primes.h"
+#include "config.h"
+#if USE_CRYPTO
+#include <openssl/rsa.h>
+#include <openssl/sha.h>
+#endif
+#if USE_OPENMP
+#include <omp.h>
+#endif
 
 // ## defaults
 // Define the default values for omitted command line arguments.
 #define DEFAULT_COUNT	    1000
 #define DEFAULT_KEY_LENGTH  2048  // >=1024
 #define DEFAULT_PUB_EXP     65537 // 3, 5, 17, 257 other Fermat primes.
+#define DEFAULT_SEED        1
+#define DEFAULT_CLUSTER     2
+
+// The GMP mode generates and writes the keys in blocks of this count.
+#define GEN_BLOCK 65536
+
+#define GEN_MAX_SIZES 64
+
+// The prime candidates are sieved by the primes below `GEN_SIEVE_BOUND` in
+// windows of `GEN_SIEVE_SIZE` odd numbers.
+#define GEN_SIEVE_BOUND 65536
+#define GEN_SIEVE_SIZE 4096
 
 // ## helpers
 
+#if USE_CRYPTO
 // Transform an `SHA1` hash to an hex string.
 void SHA1BinaryToHex(const unsigned char *bin, char *hex) {
 	int i;
@@ -28,6 +53,280 @@ void SHA1BinaryToHex(const unsigned char *bin, char *hex) {
 	}
 	hex[40]=0;
 }
+#endif
+
+// The finalizer of splitmix64, used to derive independent seeds.
+static uint64_t gen_mix(uint64_t x) {
+	x += 0x9e3779b97f4a7c15ULL;
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+	return x ^ (x >> 31);
+}
+
+// Seed `state` for item `i` of `stream`. Every key and every cluster prime
+// has its own seed, so the corpus doesn't depend on the thread count. The
+// states are linear congruential, seeding the Mersenne twister takes
+// longer than generating a small key.
+static void gen_seed(gmp_randstate_t state, uint64_t seed, uint64_t stream, uint64_t i) {
+	gmp_randseed_ui(state, (unsigned long)gen_mix(seed ^ gen_mix((stream << 56) ^ i)));
+}
+
+// The odd primes of the sieve.
+static unsigned long *small_primes = NULL;
+static size_t small_count = 0;
+
+static void gen_sieve_init() {
+	mpz_array a;
+	size_t i;
+
+	array_init(&a, 8192);
+	primes_sieve(&a, GEN_SIEVE_BOUND);
+	small_primes = (unsigned long *)malloc(a.used * sizeof(unsigned long));
+	for (i = 1; i < a.used; i++)
+		small_primes[small_count++] = mpz_get_ui(a.array[i]);
+	array_clear(&a);
+}
+
+// A random prime of `bits` bits. The two highest bits are set, so the
+// product of two of them has the sum of their bits.
+//
+// This is the next prime after a random start like `mpz_nextprime`, but
+// the odd candidates are sieved a window at a time and the survivors only
+// get one round of `mpz_probab_prime_p`, which is Baillie-PSW since GMP
+// 6.2. The 25 Miller-Rabin rounds of `mpz_nextprime` cost most of its time.
+static void gen_prime(mpz_t p, gmp_randstate_t state, unsigned long bits) {
+	unsigned char sieve[GEN_SIEVE_SIZE];
+	unsigned long q, k;
+	size_t i;
+	mpz_t c;
+
+	mpz_urandomb(p, state, bits);
+	mpz_setbit(p, bits - 1);
+	mpz_setbit(p, bits - 2);
+	mpz_setbit(p, 0);
+	mpz_init(c);
+	while (1) {
+		// `p + 2k` is divided by `q` if `k = -p / 2 (mod q)`.
+		memset(sieve, 1, GEN_SIEVE_SIZE);
+		for (i = 0; i < small_count; i++) {
+			q = small_primes[i];
+			k = ((q - mpz_fdiv_ui(p, q)) % q) * ((q + 1) / 2) % q;
+			for (; k < GEN_SIEVE_SIZE; k += q)
+				sieve[k] = 0;
+		}
+		for (k = 0; k < GEN_SIEVE_SIZE; k++) {
+			if (!sieve[k])
+				continue;
+			mpz_add_ui(c, p, 2 * k);
+			if (mpz_probab_prime_p(c, 1) > 0) {
+				mpz_swap(p, c);
+				mpz_clear(c);
+				return;
+			}
+		}
+		mpz_add_ui(p, p, 2 * GEN_SIEVE_SIZE);
+	}
+}
+
+// Parse a comma separated list of key lengths. Returns the count, 0 on
+// error.
+static size_t parse_sizes(long *sizes, const char *list) {
+	const char *s = list;
+	char *end;
+	size_t n = 0;
+
+	while (n < GEN_MAX_SIZES) {
+		sizes[n] = strtol(s, &end, 0);
+		if (end == s || sizes[n] < 16)
+			return 0;
+		n++;
+		if (*end == '\0')
+			return n;
+		if (*end != ',')
+			return 0;
+		s = end + 1;
+	}
+	return 0;
+}
+
+// ## synthetic corpora
+//
+// The layout of the corpus is planned first by a single random stream:
+// the length of every key, which keys form the clusters sharing a prime and
+// which keys duplicate an earlier key of their block. The keys themselves
+// are generated in parallel from their own seeds.
+//
+// The ground truth of the planted weaknesses is written as lines of text,
+// the indices count from the first key of this run:
+//
+//     <index> shared <cluster> <p> <q>
+//     <index> duplicate <index of the original>
+typedef struct {
+	long count;
+	uint64_t seed;
+	long *sizes;
+	size_t size_count;
+	double weak_rate;
+	long cluster_size;
+	double dup_rate;
+} corpus_params;
+
+// The next number of the plan stream.
+static uint64_t plan_next(uint64_t *x) {
+	*x += 0x9e3779b97f4a7c15ULL;
+	return gen_mix(*x);
+}
+
+// Generate the corpus to `out` and the ground truth to `truth`, which may
+// be NULL. Returns the number of keys written.
+static long gen_corpus(corpus_params *par, FILE *out, FILE *truth, int oflg) {
+	long *bits, *cluster, *source, *cluster_bits, *members;
+	long clusters, weak, i, j, k, from, to;
+	uint64_t x = par->seed;
+	mpz_t *primes, *keys, *shared, q;
+	long written = 0;
+
+	if (small_primes == NULL)
+		gen_sieve_init();
+	// Plan the key lengths.
+	bits = (long *)malloc(par->count * sizeof(long));
+	cluster = (long *)malloc(par->count * sizeof(long));
+	source = (long *)malloc(par->count * sizeof(long));
+	for (i = 0; i < par->count; i++) {
+		bits[i] = par->sizes[plan_next(&x) % par->size_count];
+		cluster[i] = -1;
+		source[i] = i;
+	}
+
+	// Pick the members of the clusters by a partial shuffle. A cluster
+	// takes the length of its first member.
+	clusters = (long)(par->count * par->weak_rate / par->cluster_size + 0.5);
+	weak = clusters * par->cluster_size;
+	if (weak > par->count) {
+		clusters = par->count / par->cluster_size;
+		weak = clusters * par->cluster_size;
+	}
+	members = (long *)malloc(par->count * sizeof(long));
+	for (i = 0; i < par->count; i++)
+		members[i] = i;
+	cluster_bits = (long *)malloc((clusters > 0 ? clusters : 1) * sizeof(long));
+	for (i = 0; i < weak; i++) {
+		j = i + (long)(plan_next(&x) % (uint64_t)(par->count - i));
+		k = members[i];
+		members[i] = members[j];
+		members[j] = k;
+		if (i % par->cluster_size == 0)
+			cluster_bits[i / par->cluster_size] = bits[members[i]];
+		cluster[members[i]] = i / par->cluster_size;
+		bits[members[i]] = cluster_bits[i / par->cluster_size];
+	}
+	free(members);
+
+	// Duplicates copy an earlier original key of the same block.
+	for (i = 0; i < par->count; i++) {
+		if (par->dup_rate <= 0 || i % GEN_BLOCK == 0 ||
+			(double)(plan_next(&x) >> 11) / 9007199254740992.0 >= par->dup_rate)
+			continue;
+		from = i - i % GEN_BLOCK;
+		source[i] = source[from + (long)(plan_next(&x) % (uint64_t)(i - from))];
+		cluster[i] = -1;
+	}
+
+	// The shared primes have half the length of their cluster.
+	primes = (mpz_t *)malloc((clusters > 0 ? clusters : 1) * sizeof(mpz_t));
+	for (i = 0; i < clusters; i++)
+		mpz_init(primes[i]);
+#if USE_OPENMP
+	#pragma omp parallel for schedule(dynamic, 16)
+#endif
+	for (i = 0; i < clusters; i++) {
+		gmp_randstate_t state;
+		gmp_randinit_lc_2exp_size(state, 128);
+		gen_seed(state, par->seed, 1, (uint64_t)i);
+		gen_prime(primes[i], state, (unsigned long)cluster_bits[i] / 2);
+		gmp_randclear(state);
+	}
+
+	// Generate and write the keys block by block.
+	keys = (mpz_t *)malloc(GEN_BLOCK * sizeof(mpz_t));
+	shared = (mpz_t *)malloc(GEN_BLOCK * sizeof(mpz_t));
+	for (i = 0; i < GEN_BLOCK; i++) {
+		mpz_init(keys[i]);
+		mpz_init(shared[i]);
+	}
+	mpz_init(q);
+	for (from = 0; from < par->count; from += GEN_BLOCK) {
+		to = from + GEN_BLOCK < par->count ? from + GEN_BLOCK : par->count;
+#if USE_OPENMP
+		#pragma omp parallel
+#endif
+		{
+			gmp_randstate_t state;
+			mpz_t p, r;
+			long n;
+
+			gmp_randinit_lc_2exp_size(state, 128);
+			mpz_init(p);
+			mpz_init(r);
+#if USE_OPENMP
+			#pragma omp for schedule(dynamic, 16)
+#endif
+			for (n = from; n < to; n++) {
+				if (source[n] != n)
+					continue;
+				gen_seed(state, par->seed, 0, (uint64_t)n);
+				if (cluster[n] >= 0) {
+					mpz_set(p, primes[cluster[n]]);
+				} else {
+					gen_prime(p, state, (unsigned long)bits[n] / 2);
+				}
+				gen_prime(r, state, (unsigned long)(bits[n] - bits[n] / 2));
+				mpz_mul(keys[n - from], p, r);
+				mpz_set(shared[n - from], p);
+			}
+			mpz_clear(p);
+			mpz_clear(r);
+			gmp_randclear(state);
+		}
+
+		for (i = from; i < to; i++) {
+			if (source[i] != i)
+				mpz_set(keys[i - from], keys[source[i] - from]);
+			if (mpz_out_raw(out, keys[i - from]) == 0) {
+				fprintf(stderr, "Cannot write the keys.\n");
+				break;
+			}
+			written++;
+			if (oflg > 0)
+				gmp_fprintf(stderr, "%Zd\n", keys[i - from]);
+			if (truth != NULL && source[i] != i) {
+				fprintf(truth, "%ld duplicate %ld\n", i, source[i]);
+			} else if (truth != NULL && cluster[i] >= 0) {
+				mpz_divexact(q, keys[i - from], shared[i - from]);
+				gmp_fprintf(truth, "%ld shared %ld %Zd %Zd\n", i, cluster[i], shared[i - from], q);
+			}
+		}
+	}
+
+	mpz_clear(q);
+	for (i = 0; i < GEN_BLOCK; i++) {
+		mpz_clear(keys[i]);
+		mpz_clear(shared[i]);
+	}
+	free(keys);
+	free(shared);
+	for (i = 0; i < clusters; i++)
+		mpz_clear(primes[i]);
+	free(primes);
+	free(cluster_bits);
+	free(bits);
+	free(cluster);
+	free(source);
+	free(small_primes);
+	small_primes = NULL;
+	small_count = 0;
+	return written;
+}
 
 // # main
 
@@ -35,14 +334,18 @@ void SHA1BinaryToHex(const unsigned char *bin, char *hex) {
 int main (int argc, char *argv[]) {
 
 	// Define the variables set by the argument parser
-	int c, vflg = 0, sflg = 0, oflg = 0, fflg = 0, errflg = 0;
+	int c, vflg = 0, sflg = 0, oflg = 0, fflg = 0, gflg = 0, errflg = 0;
 	long int count = DEFAULT_COUNT;
 	long int keylength = DEFAULT_KEY_LENGTH;
 	long int e = DEFAULT_PUB_EXP;
 	char *filename = "primes.lst";
+	char *truth_file = NULL;
+	long sizes[GEN_MAX_SIZES];
+	corpus_params par;
 
 	// and the variables used by the key generation loop.
-	FILE *out;
+	FILE *out, *truth = NULL;
+#if USE_CRYPTO
 	RSA *keypair;
 	mpz_t n, p, q;
 	int i = 0;
@@ -50,9 +353,20 @@ int main (int argc, char *argv[]) {
 	size_t buff_len = 0;
 	unsigned char hash[SHA_DIGEST_LENGTH];
 	char hex[SHA_DIGEST_LENGTH*2+1];
+#else
+	// Without openssl only the GMP mode is available.
+	gflg++;
+#endif
+
+	par.seed = DEFAULT_SEED;
+	par.sizes = NULL;
+	par.size_count = 0;
+	par.weak_rate = 0;
+	par.cluster_size = DEFAULT_CLUSTER;
+	par.dup_rate = 0;
 
 	// Read the command line arguments.
-	while ((c = getopt(argc, argv, ":svofc:k:e:")) != -1) {
+	while ((c = getopt(argc, argv, ":svofgc:k:e:m:x:w:C:d:t:")) != -1) {
 		switch(c) {
 		case 's':
 			sflg++;
@@ -66,6 +380,9 @@ int main (int argc, char *argv[]) {
 		case 'f':
 			fflg++;
 			break;
+		case 'g':
+			gflg++;
+			break;
 		case 'c':
 			count = strtol(optarg, NULL, 0);
 			if (count < 1) errflg++;
@@ -78,6 +395,29 @@ int main (int argc, char *argv[]) {
 			e = strtol(optarg, NULL, 0);
 			if (e < 3) errflg++;
 			break;
+		case 'm':
+			par.size_count = parse_sizes(sizes, optarg);
+			par.sizes = sizes;
+			if (par.size_count == 0) errflg++;
+			break;
+		case 'x':
+			par.seed = strtoull(optarg, NULL, 0);
+			break;
+		case 'w':
+			par.weak_rate = strtod(optarg, NULL);
+			if (par.weak_rate < 0 || par.weak_rate > 1) errflg++;
+			break;
+		case 'C':
+			par.cluster_size = strtol(optarg, NULL, 0);
+			if (par.cluster_size < 2) errflg++;
+			break;
+		case 'd':
+			par.dup_rate = strtod(optarg, NULL);
+			if (par.dup_rate < 0 || par.dup_rate > 1) errflg++;
+			break;
+		case 't':
+			truth_file = optarg;
+			break;
 		case ':':
 			fprintf(stderr, "Option -%c requires an operand\n", optopt);
 			errflg++;
@@ -95,15 +435,24 @@ int main (int argc, char *argv[]) {
 
 	// Print the usage and exit if an error occurred during argument parsing.
 	if (errflg) {
-		fprintf(stderr, "usage: [-vsof] [-c count] [-k keylength] [-e exponent] [file]\n"\
+		fprintf(stderr, "usage: [-vsofg] [-c count] [-k keylength] [-e exponent] [file]\n"\
 						"\n\t-v        be more verbose"\
 						"\n\t-s        print sha1 hash representation"\
 						"\n\t-o        print base 10 representation"\
 						"\n\t-f        include one factorizable key"\
+						"\n\t-g        generate the keys by GMP in parallel"\
 						"\n"\
 						"\n\t-c COUNT        the amount of keys"\
 						"\n\t-k KEYLENGTH    the key length"\
 						"\n\t-e EXPONENT     the exponent of the keys"\
+						"\n"\
+						"\n\tGMP mode:"\
+						"\n\t-m K1,K2,...    pick the length of every key from this list"\
+						"\n\t-x SEED         the seed of the corpus"\
+						"\n\t-w RATE         the rate of keys sharing a prime"\
+						"\n\t-C SIZE         the number of keys sharing a prime"\
+						"\n\t-d RATE         the rate of duplicate keys"\
+						"\n\t-t FILE         write the ground truth to FILE"\
 						"\n\n");
 		exit(2);
 	}
@@ -128,6 +477,28 @@ int main (int argc, char *argv[]) {
 		}
 	}
 
+	if (gflg > 0) {
+		if (par.size_count == 0) {
+			sizes[0] = keylength;
+			par.sizes = sizes;
+			par.size_count = 1;
+		}
+		if (truth_file != NULL && (truth = fopen(truth_file, "w")) == NULL) {
+			printf("Cannot save to file %s.\n", truth_file);
+			exit(3);
+		}
+		par.count = count;
+		count = gen_corpus(&par, out, truth, oflg);
+		if (vflg > 0) {
+			fprintf(stderr, "%ld keys generated from seed %llu.\n", count, (unsigned long long)par.seed);
+		}
+		if (truth != NULL)
+			fclose(truth);
+		fclose(out);
+		return 0;
+	}
+
+#if USE_CRYPTO
 	// Initialize the the integer `n` and start the generation loop.
 	mpz_init(n);
 	for (i = 0; i < count; i++) {
@@ -181,6 +552,7 @@ int main (int argc, char *argv[]) {
 		RSA_free(keypair);
 	}
 	mpz_clear(n);
+#endif
 	// Close the output file.
 	fclose(out);
 	return 0;
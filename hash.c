@@ -0,0 +1,204 @@
+// copri, Attacking RSA by factoring coprimes
+//
+// License: GNU Lesser General Public License (LGPL), version 3 or later
+// See the lgpl.txt file in the root directory or <https://www.gnu.org/licenses/lgpl>.
+
+// Hashing of integers and a hash set of the integers of an `mpz_array`.
+//
+// See [hash test](test-hash.html) for basic usage.
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <gmp.h>
+#include "hash.h"
+
+#define HASHSET_MIN_SIZE 16
+
+// Finalizer of MurmurHash3.
+static uint64_t hash_mix(uint64_t h) {
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+	return h;
+}
+
+// Hash the sign, size and limbs of an integer.
+uint64_t mpz_hash(const mpz_t x) {
+	size_t i, n = mpz_size(x);
+	uint64_t h = hash_mix((uint64_t)n ^ ((uint64_t)(mpz_sgn(x) + 1) << 62));
+	for (i = 0; i < n; i++) {
+		h = (h ^ (uint64_t)mpz_getlimbn(x, i)) * 0x9e3779b97f4a7c15ULL;
+		h ^= h >> 29;
+	}
+	return hash_mix(h);
+}
+
+// ## hash set
+//
+// An open addressing set of indices into `array`. Two indices are equal
+// if the integers at them are equal. The slots store the index plus one,
+// so zero marks an empty slot.
+void hashset_init(mpz_hashset *h, mpz_array *array, size_t capacity) {
+	size_t size = HASHSET_MIN_SIZE;
+	while (size < 2 * capacity) size *= 2;
+	h->slots = (hash_slot *)calloc(size, sizeof(hash_slot));
+	h->size = size;
+	h->used = 0;
+	h->array = array;
+}
+
+void hashset_clear(mpz_hashset *h) {
+	free(h->slots);
+	h->slots = NULL;
+	h->size = h->used = 0;
+}
+
+// Find the slot of an integer with the hash `hash`, or the empty slot where
+// it belongs.
+static size_t hashset_slot(mpz_hashset *h, const mpz_t x, uint64_t hash) {
+	size_t i = (size_t)hash & (h->size - 1);
+	while (h->slots[i].index != 0) {
+		if (h->slots[i].hash == hash &&
+			mpz_cmp(h->array->array[h->slots[i].index - 1], x) == 0)
+			break;
+		i = (i + 1) & (h->size - 1);
+	}
+	return i;
+}
+
+// Double the slots if the set is half full.
+static void hashset_grow(mpz_hashset *h) {
+	hash_slot *old = h->slots;
+	size_t i, j, size = h->size;
+
+	h->size = 2 * size;
+	h->slots = (hash_slot *)calloc(h->size, sizeof(hash_slot));
+	for (i = 0; i < size; i++) {
+		if (old[i].index == 0) continue;
+		j = (size_t)old[i].hash & (h->size - 1);
+		while (h->slots[j].index != 0)
+			j = (j + 1) & (h->size - 1);
+		h->slots[j] = old[i];
+	}
+	free(old);
+}
+
+// Return the index of an integer equal to `x` or `HASHSET_NONE`.
+size_t hashset_find(mpz_hashset *h, const mpz_t x) {
+	size_t i = hashset_slot(h, x, mpz_hash(x));
+	return h->slots[i].index == 0 ? HASHSET_NONE : h->slots[i].index - 1;
+}
+
+// Add the integer at `index` of the array. If an equal integer is in the
+// set already its index is returned and the set is not changed, otherwise
+// `index` is returned.
+size_t hashset_add(mpz_hashset *h, size_t index) {
+	uint64_t hash;
+	size_t i;
+
+	if (2 * (h->used + 1) > h->size)
+		hashset_grow(h);
+	hash = mpz_hash(h->array->array[index]);
+	i = hashset_slot(h, h->array->array[index], hash);
+	if (h->slots[i].index != 0)
+		return h->slots[i].index - 1;
+	h->slots[i].hash = hash;
+	h->slots[i].index = index + 1;
+	h->used++;
+	return index;
+}
+
+// ## remove duplicates
+//
+// Remove the duplicates of `a` in place without sorting. The first
+// occurrence of every integer is kept and the order is preserved. If `map`
+// is not `NULL`, `map[i]` is set to the new index of the integer at the
+// old index `i`. Returns the number of unique integers.
+size_t array_dedup(mpz_array *a, size_t *map) {
+	mpz_hashset h;
+	size_t i, j, w = 0;
+
+	hashset_init(&h, a, a->used);
+	for (i = 0; i < a->used; i++) {
+		if (w != i)
+			mpz_swap(a->array[w], a->array[i]);
+		j = hashset_add(&h, w);
+		if (j == w)
+			w++;
+		if (map != NULL)
+			map[i] = j;
+	}
+	hashset_clear(&h);
+
+	// Free the duplicates which ended up behind the unique integers.
+	for (i = w; i < a->used; i++)
+		mpz_clear(a->array[i]);
+	a->used = w;
+	return w;
+}
+
+// Remove the integers of `a` which are in the set `h` in place. The order
+// of the other integers is preserved. Returns the number of removed
+// integers.
+size_t array_remove_set(mpz_array *a, mpz_hashset *h) {
+	size_t i, w = 0, n = a->used;
+
+	for (i = 0; i < n; i++) {
+		if (hashset_find(h, a->array[i]) != HASHSET_NONE)
+			continue;
+		if (w != i)
+			mpz_swap(a->array[w], a->array[i]);
+		w++;
+	}
+	for (i = w; i < n; i++)
+		mpz_clear(a->array[i]);
+	a->used = w;
+	return n - w;
+}
+
+// ## key index
+//
+// Maps every unique key back to all its indices in the input file. `map`
+// holds the index of the unique key in `keys` for each of the `n` input
+// indices, like it is returned by `array_dedup`. The index shares the
+// integers of `keys`.
+void keyindex_init(key_index *idx, mpz_array *keys, const size_t *map, size_t n) {
+	size_t i;
+
+	idx->keys = *keys;
+	idx->offsets = (size_t *)calloc(keys->used + 1, sizeof(size_t));
+	idx->indices = (size_t *)malloc((n > 0 ? n : 1) * sizeof(size_t));
+	for (i = 0; i < n; i++)
+		idx->offsets[map[i] + 1]++;
+	for (i = 0; i < keys->used; i++)
+		idx->offsets[i + 1] += idx->offsets[i];
+	// The input indices of a key are in ascending order.
+	for (i = 0; i < n; i++)
+		idx->indices[idx->offsets[map[i]]++] = i;
+	for (i = keys->used; i > 0; i--)
+		idx->offsets[i] = idx->offsets[i - 1];
+	idx->offsets[0] = 0;
+
+	hashset_init(&idx->set, &idx->keys, idx->keys.used);
+	for (i = 0; i < idx->keys.used; i++)
+		hashset_add(&idx->set, i);
+}
+
+void keyindex_clear(key_index *idx) {
+	hashset_clear(&idx->set);
+	free(idx->offsets);
+	free(idx->indices);
+}
+
+// Set `indices` to the input indices of `key` and return their count, 0 if
+// it is not an input key.
+size_t keyindex_find(key_index *idx, const mpz_t key, const size_t **indices) {
+	size_t k = hashset_find(&idx->set, key);
+
+	if (k == HASHSET_NONE)
+		return 0;
+	*indices = idx->indices + idx->offsets[k];
+	return idx->offsets[k + 1] - idx->offsets[k];
+}
@@ -0,0 +1,55 @@
+// copri, Attacking RSA by factoring coprimes
+//
+// License: GNU Lesser General Public License (LGPL), version 3 or later
+// See the lgpl.txt file in the root directory or <https://www.gnu.org/licenses/lgpl>.
+
+#ifndef HASH_H
+#define HASH_H
+
+#include <stdint.h>
+#include <gmp.h>
+#include "array.h"
+
+// Returned by `hashset_find` if the integer is not in the set.
+#define HASHSET_NONE ((size_t)-1)
+
+typedef struct {
+	uint64_t hash;
+	size_t index;
+} hash_slot;
+
+typedef struct {
+	hash_slot *slots;
+	size_t size;
+	size_t used;
+	mpz_array *array;
+} mpz_hashset;
+
+typedef struct {
+	mpz_array keys;
+	mpz_hashset set;
+	size_t *offsets;
+	size_t *indices;
+} key_index;
+
+uint64_t mpz_hash(const mpz_t x);
+
+void hashset_init(mpz_hashset *h, mpz_array *array, size_t capacity);
+
+void hashset_clear(mpz_hashset *h);
+
+size_t hashset_find(mpz_hashset *h, const mpz_t x);
+
+size_t hashset_add(mpz_hashset *h, size_t index);
+
+size_t array_dedup(mpz_array *a, size_t *map);
+
+size_t array_remove_set(mpz_array *a, mpz_hashset *h);
+
+void keyindex_init(key_index *idx, mpz_array *keys, const size_t *map, size_t n);
+
+void keyindex_clear(key_index *idx);
+
+size_t keyindex_find(key_index *idx, const mpz_t key, const size_t **indices);
+
+#endif /* HASH_H */
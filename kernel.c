@@ -0,0 +1,76 @@
+// copri, Attacking RSA by factoring coprimes
+//
+// License: GNU Lesser General Public License (LGPL), version 3 or later
+// See the lgpl.txt file in the root directory or <https://www.gnu.org/licenses/lgpl>.
+
+// Kernels for the lowest levels of the trees, where the integers are RSA
+// moduli of 1024, 2048 or 4096 bits. Operands of exactly these widths go
+// straight to the `mpn` functions with a fixed limb count, which skips the
+// size and sign checks, reallocations and temporary copies of `mpz_mul`
+// and `mpz_gcd`. All other operands use the `mpz` functions.
+//
+// The `mpn` layer picks the fastest code for the CPU at runtime (mulx/adx
+// on BMI2/ADX machines) if GMP is built as fat binary.
+#include <stdlib.h>
+#include <string.h>
+#include <gmp.h>
+#include "kernel.h"
+#include "config.h"
+
+#define KERNEL_MAX_LIMBS (4096 / GMP_NUMB_BITS)
+
+#if USE_KERNELS
+// The supported limb counts.
+static int kernel_width(mp_size_t n) {
+	return n == 1024 / GMP_NUMB_BITS || n == 2048 / GMP_NUMB_BITS ||
+		n == 4096 / GMP_NUMB_BITS;
+}
+#endif
+
+// Compute rot = a * b.
+void kernel_mul(mpz_ptr rot, mpz_srcptr a, mpz_srcptr b) {
+#if USE_KERNELS
+	mp_size_t n = mpz_size(a);
+	mp_limb_t *rp;
+
+	if (mpz_sgn(a) > 0 && mpz_sgn(b) > 0 && kernel_width(n) &&
+		(mp_size_t)mpz_size(b) == n && rot != a && rot != b) {
+		rp = mpz_limbs_write(rot, 2 * n);
+		if (a == b)
+			mpn_sqr(rp, mpz_limbs_read(a), n);
+		else
+			mpn_mul_n(rp, mpz_limbs_read(a), mpz_limbs_read(b), n);
+		mpz_limbs_finish(rot, 2 * n);
+		return;
+	}
+#endif
+	mpz_mul(rot, a, b);
+}
+
+// Compute g = gcd(a, b). The kernel is used if one operand has a supported
+// width, the other one is not longer and one of them is odd.
+void kernel_gcd(mpz_ptr g, mpz_srcptr a, mpz_srcptr b) {
+#if USE_KERNELS
+	mp_limb_t x[KERNEL_MAX_LIMBS + 1], y[KERNEL_MAX_LIMBS + 1];
+	mp_size_t xn, yn, rn;
+
+	if (mpz_sgn(a) > 0 && mpz_sgn(b) > 0 && (mpz_odd_p(a) || mpz_odd_p(b))) {
+		if (mpz_size(a) < mpz_size(b)) {
+			mpz_srcptr t = a;
+			a = b;
+			b = t;
+		}
+		xn = mpz_size(a);
+		yn = mpz_size(b);
+		if (kernel_width(xn)) {
+			// `mpn_gcd` destroys its operands.
+			memcpy(x, mpz_limbs_read(a), xn * sizeof(mp_limb_t));
+			memcpy(y, mpz_limbs_read(b), yn * sizeof(mp_limb_t));
+			rn = mpn_gcd(mpz_limbs_write(g, yn), x, xn, y, yn);
+			mpz_limbs_finish(g, rn);
+			return;
+		}
+	}
+#endif
+	mpz_gcd(g, a, b);
+}
@@ -0,0 +1,15 @@
+// copri, Attacking RSA by factoring coprimes
+//
+// License: GNU Lesser General Public License (LGPL), version 3 or later
+// See the lgpl.txt file in the root directory or <https://www.gnu.org/licenses/lgpl>.
+
+#ifndef KERNEL_H
+#define KERNEL_H
+
+#include <gmp.h>
+
+void kernel_mul(mpz_ptr rot, mpz_srcptr a, mpz_srcptr b);
+
+void kernel_gcd(mpz_ptr g, mpz_srcptr a, mpz_srcptr b);
+
+#endif /* KERNEL_H */
@@ -0,0 +1,480 @@
+// copri, Attacking RSA by factoring coprimes
+//
+// License: GNU Lesser General Public License (LGPL), version 3 or later
+// See the lgpl.txt file in the root directory or <https://www.gnu.org/licenses/lgpl>.
+
+// Memory accounting for GMP. `memory_init` installs allocation functions
+// via `mp_set_memory_functions` which count the bytes and calls of every
+// thread. GMP passes the old size to `realloc` and `free`, so no header
+// has to be stored in front of the blocks.
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <gmp.h>
+#include "memory.h"
+#include "config.h"
+#if USE_HUGEPAGES
+#include <sys/mman.h>
+#endif
+
+static int installed = 0;
+
+static long long total_current = 0;
+static long long total_peak = 0;
+
+// Every thread gets its own slot on the first allocation. If there are
+// more threads than slots the remaining threads share the last one.
+static memory_stats threads[MEMORY_MAX_THREADS];
+static size_t thread_count = 0;
+
+// The high-water mark of the total bytes while the allocating thread
+// worked on a given `cb` recursion depth.
+static long long depth_peak[MEMORY_MAX_DEPTH];
+
+static __thread memory_stats *local = NULL;
+static __thread int local_depth = 0;
+
+// #### arenas
+// Inside an arena scope new blocks are taken from a thread-local buffer by
+// bumping an offset. Freeing a block only gives the memory back if it is
+// the last one, everything else is released at once when the scope ends.
+// Blocks which do not fit fall back to `malloc`.
+#define ARENA_ALIGN 16
+
+typedef struct {
+	char *base;
+	size_t size;
+	size_t top;
+	int active;
+	int paused;
+} memory_arena;
+
+static size_t arena_size = 0;
+
+static __thread memory_arena arena = { NULL, 0, 0, 0, 0 };
+
+// The buffers of the arenas of all threads. A block of one thread can be
+// reallocated or freed by an other one, e.g. by the team of a nested
+// parallel region, so the owner is looked up in all of them. The buffers
+// are never freed, an entry stays valid after its thread exits.
+typedef struct {
+	char *base;
+	size_t size;
+} memory_arena_buffer;
+
+static memory_arena_buffer arenas[MEMORY_MAX_THREADS];
+static size_t arena_count = 0;
+
+// Test if `ptr` is in the arena of the calling thread.
+static int in_arena(const void *ptr) {
+	return arena.base != NULL && (const char *)ptr >= arena.base &&
+		(const char *)ptr < arena.base + arena.size;
+}
+
+// Test if `ptr` is in the arena of any thread.
+static int in_any_arena(const void *ptr) {
+	size_t i, n;
+	char *base;
+	if (arena_size == 0)
+		return 0;
+	n = __atomic_load_n(&arena_count, __ATOMIC_ACQUIRE);
+	if (n > MEMORY_MAX_THREADS) n = MEMORY_MAX_THREADS;
+	for (i = 0; i < n; i++) {
+		base = __atomic_load_n(&arenas[i].base, __ATOMIC_ACQUIRE);
+		if (base != NULL && (const char *)ptr >= base &&
+			(const char *)ptr < base + arenas[i].size)
+			return 1;
+	}
+	return 0;
+}
+
+static void *arena_alloc(size_t size) {
+	void *ptr;
+	size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+	if (!arena.active || arena.paused || size > arena.size - arena.top)
+		return NULL;
+	ptr = arena.base + arena.top;
+	arena.top += size;
+	return ptr;
+}
+
+// Give the block back if it is the last one.
+static void arena_free(void *ptr, size_t size) {
+	size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+	if ((char *)ptr + size == arena.base + arena.top)
+		arena.top -= size;
+}
+
+// Grow the last block in place.
+static int arena_grow(void *ptr, size_t old_size, size_t new_size) {
+	old_size = (old_size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+	new_size = (new_size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+	if (!arena.active || arena.paused ||
+		(char *)ptr + old_size != arena.base + arena.top ||
+		new_size - old_size > arena.size - arena.top)
+		return 0;
+	arena.top += new_size - old_size;
+	return 1;
+}
+
+// #### hugepages
+// Blocks of at least `huge_threshold` bytes are mapped by `mmap` and
+// marked with `MADV_HUGEPAGE`, so the kernel can back them by transparent
+// hugepages. GMP passes the size of a block to `realloc` and `free`,
+// which tells if a block was mapped. The threshold must not change while
+// mapped blocks exist.
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+static size_t huge_threshold = 0;
+static long long huge_mapped = 0;
+
+static int is_huge(size_t size) {
+	return huge_threshold > 0 && size >= huge_threshold;
+}
+
+#if USE_HUGEPAGES
+static size_t huge_length(size_t size) {
+	return (size + HUGE_PAGE_SIZE - 1) & ~(size_t)(HUGE_PAGE_SIZE - 1);
+}
+
+// Map one hugepage more than needed and trim the ends to align the block.
+static void *huge_alloc(size_t size) {
+	size_t len = huge_length(size), head;
+	char *ptr = mmap(NULL, len + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (ptr == MAP_FAILED)
+		return NULL;
+	head = (HUGE_PAGE_SIZE - ((size_t)ptr & (HUGE_PAGE_SIZE - 1))) & (HUGE_PAGE_SIZE - 1);
+	if (head > 0)
+		munmap(ptr, head);
+	munmap(ptr + head + len, HUGE_PAGE_SIZE - head);
+	ptr += head;
+	madvise(ptr, len, MADV_HUGEPAGE);
+	__atomic_add_fetch(&huge_mapped, (long long)len, __ATOMIC_RELAXED);
+	return ptr;
+}
+
+static void huge_free(void *ptr, size_t size) {
+	munmap(ptr, huge_length(size));
+	__atomic_sub_fetch(&huge_mapped, (long long)huge_length(size), __ATOMIC_RELAXED);
+}
+
+static void *huge_realloc(void *ptr, size_t old_size, size_t new_size) {
+	size_t old_len = huge_length(old_size), new_len = huge_length(new_size);
+	if (old_len == new_len)
+		return ptr;
+	ptr = mremap(ptr, old_len, new_len, MREMAP_MAYMOVE);
+	if (ptr == MAP_FAILED)
+		return NULL;
+	madvise(ptr, new_len, MADV_HUGEPAGE);
+	__atomic_add_fetch(&huge_mapped, (long long)new_len - (long long)old_len, __ATOMIC_RELAXED);
+	return ptr;
+}
+#else
+static void *huge_alloc(size_t size) {
+	return malloc(size);
+}
+
+static void huge_free(void *ptr, size_t size) {
+	free(ptr);
+}
+
+static void *huge_realloc(void *ptr, size_t old_size, size_t new_size) {
+	return realloc(ptr, new_size);
+}
+#endif
+
+static memory_stats *memory_local(void) {
+	size_t i;
+	if (local == NULL) {
+		i = __atomic_fetch_add(&thread_count, 1, __ATOMIC_RELAXED);
+		if (i >= MEMORY_MAX_THREADS) i = MEMORY_MAX_THREADS - 1;
+		local = &threads[i];
+	}
+	return local;
+}
+
+static void memory_max(long long *peak, long long value) {
+	long long old = __atomic_load_n(peak, __ATOMIC_RELAXED);
+	while (value > old && !__atomic_compare_exchange_n(peak, &old, value,
+		1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+
+// Memory freed by an other thread than the allocating one is subtracted
+// from the freeing thread, so the current bytes of a single thread can
+// be negative.
+static void memory_account(memory_stats *t, long long delta) {
+	long long cur = __atomic_add_fetch(&total_current, delta, __ATOMIC_RELAXED);
+	long long tcur = __atomic_add_fetch(&t->current, delta, __ATOMIC_RELAXED);
+	if (delta > 0) {
+		memory_max(&total_peak, cur);
+		memory_max(&t->peak, tcur);
+		memory_max(&depth_peak[local_depth], cur);
+	}
+}
+
+static void *memory_alloc(size_t size) {
+	memory_stats *t = memory_local();
+	void *ptr = arena_alloc(size);
+	if (ptr != NULL) {
+		__atomic_add_fetch(&t->arena, 1, __ATOMIC_RELAXED);
+	} else if (is_huge(size)) {
+		ptr = huge_alloc(size);
+	} else {
+		ptr = malloc(size);
+	}
+	if (ptr == NULL) {
+		fprintf(stderr, "Can't allocate %zu bytes\n", size);
+		abort();
+	}
+	__atomic_add_fetch(&t->allocs, 1, __ATOMIC_RELAXED);
+	memory_account(t, (long long)size);
+	return ptr;
+}
+
+static void *memory_realloc(void *ptr, size_t old_size, size_t new_size) {
+	memory_stats *t = memory_local();
+	int own = in_arena(ptr), other = !own && in_any_arena(ptr);
+	void *next;
+	if (other) {
+		// The block of an other thread's arena is left to its scope.
+		next = is_huge(new_size) ? huge_alloc(new_size) : malloc(new_size);
+		if (next != NULL)
+			memcpy(next, ptr, old_size < new_size ? old_size : new_size);
+		ptr = next;
+	} else if (!own && is_huge(old_size) && is_huge(new_size)) {
+		ptr = huge_realloc(ptr, old_size, new_size);
+	} else if (!own && (is_huge(old_size) || is_huge(new_size))) {
+		// Move the block between `malloc` and `mmap`.
+		next = is_huge(new_size) ? huge_alloc(new_size) : malloc(new_size);
+		if (next != NULL)
+			memcpy(next, ptr, old_size < new_size ? old_size : new_size);
+		if (is_huge(old_size))
+			huge_free(ptr, old_size);
+		else
+			free(ptr);
+		ptr = next;
+	} else if (!own) {
+		ptr = realloc(ptr, new_size);
+	} else if (new_size <= old_size || arena_grow(ptr, old_size, new_size)) {
+		// nothing to move
+	} else {
+		next = arena_alloc(new_size);
+		if (next != NULL) {
+			__atomic_add_fetch(&t->arena, 1, __ATOMIC_RELAXED);
+		} else if (is_huge(new_size)) {
+			next = huge_alloc(new_size);
+		} else {
+			next = malloc(new_size);
+		}
+		if (next != NULL)
+			memcpy(next, ptr, old_size);
+		arena_free(ptr, old_size);
+		ptr = next;
+	}
+	if (ptr == NULL) {
+		fprintf(stderr, "Can't reallocate %zu bytes\n", new_size);
+		abort();
+	}
+	__atomic_add_fetch(&t->reallocs, 1, __ATOMIC_RELAXED);
+	memory_account(t, (long long)new_size - (long long)old_size);
+	return ptr;
+}
+
+static void memory_free(void *ptr, size_t size) {
+	memory_stats *t = memory_local();
+	if (in_arena(ptr))
+		arena_free(ptr, size);
+	else if (in_any_arena(ptr))
+		; // released when the scope of the other thread ends
+	else if (is_huge(size))
+		huge_free(ptr, size);
+	else
+		free(ptr);
+	__atomic_add_fetch(&t->frees, 1, __ATOMIC_RELAXED);
+	memory_account(t, -(long long)size);
+}
+
+// Install the accounting functions. This has to happen before the first
+// integer is initialized, otherwise blocks allocated before are freed
+// without being counted.
+void memory_init(void) {
+	mp_set_memory_functions(memory_alloc, memory_realloc, memory_free);
+	installed = 1;
+}
+
+int memory_installed(void) {
+	return installed;
+}
+
+// Start a new phase: the peaks are set to the current bytes and the
+// counters to zero. Must not be called while other threads allocate.
+void memory_reset(void) {
+	size_t i, n = thread_count < MEMORY_MAX_THREADS ? thread_count : MEMORY_MAX_THREADS;
+	total_peak = total_current;
+	for (i = 0; i < n; i++) {
+		threads[i].peak = threads[i].current;
+		threads[i].allocs = threads[i].reallocs = threads[i].frees = 0;
+		threads[i].arena = 0;
+	}
+	for (i = 0; i < MEMORY_MAX_DEPTH; i++)
+		depth_peak[i] = 0;
+}
+
+// The sum over all threads.
+void memory_total(memory_stats *stats) {
+	size_t i, n = thread_count < MEMORY_MAX_THREADS ? thread_count : MEMORY_MAX_THREADS;
+	stats->current = total_current;
+	stats->peak = total_peak;
+	stats->allocs = stats->reallocs = stats->frees = stats->arena = 0;
+	for (i = 0; i < n; i++) {
+		stats->arena += threads[i].arena;
+		stats->allocs += threads[i].allocs;
+		stats->reallocs += threads[i].reallocs;
+		stats->frees += threads[i].frees;
+	}
+}
+
+// Copy the stats of at most `size` threads and return the copied count.
+size_t memory_threads(memory_stats *stats, size_t size) {
+	size_t i, n = thread_count < MEMORY_MAX_THREADS ? thread_count : MEMORY_MAX_THREADS;
+	if (n > size) n = size;
+	for (i = 0; i < n; i++)
+		stats[i] = threads[i];
+	return n;
+}
+
+// Copy the high-water marks of at most `size` recursion depths and
+// return the number of depths used.
+size_t memory_depths(long long *peaks, size_t size) {
+	size_t i, n = 0;
+	for (i = 0; i < MEMORY_MAX_DEPTH && i < size; i++) {
+		peaks[i] = depth_peak[i];
+		if (peaks[i] > 0) n = i + 1;
+	}
+	return n;
+}
+
+// Set the recursion depth the calling thread works on.
+void memory_set_depth(int depth) {
+	if (depth < 0) depth = 0;
+	if (depth >= MEMORY_MAX_DEPTH) depth = MEMORY_MAX_DEPTH - 1;
+	local_depth = depth;
+}
+
+// Enable arenas of `size` bytes per thread and install the accounting
+// functions. The buffers are allocated by the first scope of every thread
+// and kept for the following scopes.
+void memory_arena_init(size_t size) {
+	if (!installed)
+		memory_init();
+	arena_size = size;
+}
+
+// Start an arena scope. The returned mark has to be passed to
+// `memory_arena_end`. Scopes can be nested.
+size_t memory_arena_begin(void) {
+	size_t i;
+	char *base;
+
+	if (arena_size == 0)
+		return 0;
+	if (arena.base == NULL) {
+		i = __atomic_fetch_add(&arena_count, 1, __ATOMIC_RELAXED);
+		if (i >= MEMORY_MAX_THREADS)
+			return 0;
+		base = (char *)malloc(arena_size);
+		if (base == NULL) {
+			fprintf(stderr, "Can't allocate an arena of %zu bytes\n", arena_size);
+			return 0;
+		}
+		arenas[i].size = arena_size;
+		__atomic_store_n(&arenas[i].base, base, __ATOMIC_RELEASE);
+		arena.base = base;
+		arena.size = arena_size;
+	}
+	arena.active++;
+	return arena.top;
+}
+
+// Copy the integers `a[0..n-1]` out of the arenas. Integers which existed
+// before the scope but may have been written inside it, like the free
+// integers of a `pool`, have to be kept by this before the scope ends.
+// GMP moves the limbs of an integer into a new block on some aliased
+// operations, so such an integer can own arena memory afterwards.
+void memory_arena_keep(mpz_t *a, size_t n) {
+	mpz_t x;
+	size_t i;
+
+	if (arena_size == 0)
+		return;
+	arena.paused++;
+	for (i = 0; i < n; i++) {
+		if (in_any_arena(mpz_limbs_read(a[i]))) {
+			mpz_init_set(x, a[i]);
+			mpz_swap(x, a[i]);
+			mpz_clear(x);
+		}
+	}
+	arena.paused--;
+}
+
+// End an arena scope. The integers `keep[from..]` survive the scope, they
+// are copied out of the arena. All other blocks allocated since `mark`
+// are released and must not be used any more.
+void memory_arena_end(size_t mark, mpz_array *keep, size_t from) {
+	if (arena_size == 0 || arena.base == NULL || arena.active == 0)
+		return;
+	if (keep != NULL && keep->used > from)
+		memory_arena_keep(keep->array + from, keep->used - from);
+	arena.active--;
+	arena.top = mark;
+}
+
+// Integers which outlive the scope but are not part of its output (like
+// new `pool` integers) have to be allocated while the arena is paused.
+void memory_arena_pause(void) {
+	arena.paused++;
+}
+
+void memory_arena_resume(void) {
+	arena.paused--;
+}
+
+// Map blocks of at least `threshold` bytes on hugepages and install the
+// accounting functions. Has to be called before the first block of this
+// size is allocated. Returns 0 if hugepages are not supported.
+int memory_huge_init(size_t threshold) {
+#if USE_HUGEPAGES
+	if (!installed)
+		memory_init();
+	huge_threshold = threshold;
+	return 1;
+#else
+	return 0;
+#endif
+}
+
+// The bytes currently mapped for blocks above the threshold.
+long long memory_huge_mapped(void) {
+	return huge_mapped;
+}
+
+// The anonymous memory of the process which is backed by hugepages,
+// -1 if the kernel does not report it.
+long long memory_huge_backed(void) {
+	FILE *f;
+	char line[256];
+	long long kb = -1;
+
+	f = fopen("/proc/self/smaps_rollup", "r");
+	if (f == NULL)
+		return -1;
+	while (fgets(line, sizeof(line), f) != NULL) {
+		if (sscanf(line, "AnonHugePages: %lld kB", &kb) == 1)
+			break;
+	}
+	fclose(f);
+	return kb < 0 ? -1 : kb * 1024;
+}
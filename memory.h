@@ -0,0 +1,58 @@
+// copri, Attacking RSA by factoring coprimes
+//
+// License: GNU Lesser General Public License (LGPL), version 3 or later
+// See the lgpl.txt file in the root directory or <https://www.gnu.org/licenses/lgpl>.
+
+#ifndef MEMORY_H
+#define MEMORY_H
+
+#include <stddef.h>
+#include <gmp.h>
+#include "array.h"
+
+#define MEMORY_MAX_THREADS 256
+
+#define MEMORY_MAX_DEPTH 64
+
+typedef struct {
+	long long current;
+	long long peak;
+	size_t allocs;
+	size_t reallocs;
+	size_t frees;
+	size_t arena;
+} memory_stats;
+
+void memory_init(void);
+
+int memory_installed(void);
+
+void memory_reset(void);
+
+void memory_total(memory_stats *stats);
+
+size_t memory_threads(memory_stats *stats, size_t size);
+
+size_t memory_depths(long long *peaks, size_t size);
+
+void memory_set_depth(int depth);
+
+void memory_arena_init(size_t size);
+
+size_t memory_arena_begin(void);
+
+void memory_arena_keep(mpz_t *a, size_t n);
+
+void memory_arena_end(size_t mark, mpz_array *keep, size_t from);
+
+void memory_arena_pause(void);
+
+void memory_arena_resume(void);
+
+int memory_huge_init(size_t threshold);
+
+long long memory_huge_mapped(void);
+
+long long memory_huge_backed(void);
+
+#endif /* MEMORY_H */
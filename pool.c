@@ -8,6 +8,7 @@
 #include <unistd.h>
 #include <gmp.h>
 #include "pool.h"
+#include "memory.h"
 
 #define POOL_DEFAULT_SIZE 256
 
@@ -77,9 +78,12 @@ void pool_pop(mpz_pool *p, mpz_t ret) {
 			p->array,
 			(p->size + POOL_REALLOC_SIZE) * sizeof(mpz_t)
 		);
+		// The new integers outlive an arena scope.
+		memory_arena_pause();
 		for (i=p->size; i<(p->size + POOL_REALLOC_SIZE); i++) {
 			mpz_init2(p->array[i], p->init_bit_size);
 		}
+		memory_arena_resume();
 		p->size += POOL_REALLOC_SIZE;
 	}
 	mpz_swap(p->array[p->used++], ret);
@@ -0,0 +1,52 @@
+// copri, Attacking RSA by factoring coprimes
+//
+// License: GNU Lesser General Public License (LGPL), version 3 or later
+// See the lgpl.txt file in the root directory or <https://www.gnu.org/licenses/lgpl>.
+
+// Generate small primes by the sieve of Eratosthenes.
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <gmp.h>
+#include "primes.h"
+
+// Add all primes < `bound` to `ret` in ascending order and return their
+// count. Only odd numbers are sieved, `odd[k]` stands for 2k+1.
+size_t primes_sieve(mpz_array *ret, unsigned long bound) {
+	unsigned char *odd;
+	unsigned long n, k, j;
+	size_t count = 0;
+	mpz_t p;
+
+	if (bound <= 2)
+		return 0;
+
+	mpz_init_set_ui(p, 2);
+	array_add(ret, p);
+	count++;
+
+	n = bound / 2;
+	odd = (unsigned char *)malloc(n);
+	if (odd == NULL) {
+		fprintf(stderr, "Can't allocate a sieve for %lu\n", bound);
+		mpz_clear(p);
+		return count;
+	}
+	memset(odd, 1, n);
+	for (k = 1; k < n; k++) {
+		if (!odd[k])
+			continue;
+		// Cross out the odd multiples starting at (2k+1)^2.
+		for (j = 2 * k * (k + 1); j < n; j += 2 * k + 1)
+			odd[j] = 0;
+		if (2 * k + 1 < bound) {
+			mpz_set_ui(p, 2 * k + 1);
+			array_add(ret, p);
+			count++;
+		}
+	}
+
+	free(odd);
+	mpz_clear(p);
+	return count;
+}
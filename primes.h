@@ -0,0 +1,17 @@
+// copri, Attacking RSA by factoring coprimes
+//
+// License: GNU Lesser General Public License (LGPL), version 3 or later
+// See the lgpl.txt file in the root directory or <https://www.gnu.org/licenses/lgpl>.
+
+#ifndef PRIMES_H
+#define PRIMES_H
+
+#include <gmp.h>
+#include "array.h"
+
+// The bound of the first 1000 primes (the 1000th prime is 7919).
+#define PRIMES_DEFAULT_BOUND 7920
+
+size_t primes_sieve(mpz_array *ret, unsigned long bound);
+
+#endif /* PRIMES_H */
@@ -0,0 +1,166 @@
+// copri, Attacking RSA by factoring coprimes
+//
+// License: GNU Lesser General Public License (LGPL), version 3 or later
+// See the lgpl.txt file in the root directory or <https://www.gnu.org/licenses/lgpl>.
+
+// Random samples of raw GMP streams.
+//
+// The stream is read once by reservoir sampling (Algorithm R), only the
+// integers kept in the reservoir are converted to `mpz_t`. The memory is
+// bounded by the sample size, not by the stream.
+//
+// See [sample test](test-sample.html) for basic usage.
+#include <stdlib.h>
+#include <stdio.h>
+#include <gmp.h>
+#include "sample.h"
+
+// One reservoir per stratum of integers with the same bit size bucket.
+typedef struct {
+	mpz_array reservoir;
+	size_t seen;
+} sample_stratum;
+
+// Read the next integer of a raw GMP stream into `buf` without converting
+// it. Returns the number of bytes of the magnitude or -1 at the end of the
+// stream. The sign is stored in `neg`.
+static long sample_read(FILE *in, unsigned char **buf, size_t *size, int *neg) {
+	unsigned char h[4];
+	long n;
+
+	if (fread(h, 1, 4, in) != 4)
+		return -1;
+	n = (long)(int)(((unsigned)h[0] << 24) | ((unsigned)h[1] << 16) | ((unsigned)h[2] << 8) | h[3]);
+	*neg = n < 0;
+	if (n < 0) n = -n;
+	if ((size_t)n > *size) {
+		*size = (size_t)n;
+		*buf = (unsigned char *)realloc(*buf, *size);
+	}
+	if (n > 0 && fread(*buf, 1, (size_t)n, in) != (size_t)n)
+		return -1;
+	return n;
+}
+
+// The bit size of a big endian magnitude of `n` bytes. Zero has one bit
+// like in `mpz_sizeinbase`.
+static unsigned long sample_bits(const unsigned char *buf, long n) {
+	unsigned long bits;
+	unsigned char top;
+	long i = 0;
+
+	while (i < n && buf[i] == 0) i++;
+	if (i == n) return 1;
+	bits = 8 * (unsigned long)(n - i);
+	for (top = buf[i]; !(top & 0x80); top <<= 1)
+		bits--;
+	return bits;
+}
+
+// Move a random subset of `k` integers of `r` to `sample` by a partial
+// Fisher-Yates shuffle.
+static void sample_take(mpz_array *sample, mpz_array *r, size_t k, gmp_randstate_t state) {
+	size_t i, j;
+
+	for (i = 0; i < k; i++) {
+		j = i + gmp_urandomm_ui(state, r->used - i);
+		mpz_swap(r->array[i], r->array[j]);
+		array_add(sample, r->array[i]);
+	}
+}
+
+// ## sample a stream
+//
+// Draw a uniform random sample of `k` integers from the raw GMP stream `in`.
+// Integers with less than `min_bits` or, if `max_bits` is not zero, more
+// than `max_bits` bits are skipped. The number of the other integers is
+// stored in `count`.
+//
+// If `width` is not zero the integers are stratified by `bits / width` and
+// every stratum gets its share of the sample by its count. Every stratum
+// keeps a reservoir of `k` integers.
+//
+// Returns the number of integers added to `sample`, which is less than `k`
+// if the stream is shorter.
+size_t array_sample_stdio(mpz_array *sample, FILE *in, size_t k, unsigned long width,
+unsigned long min_bits, unsigned long max_bits, gmp_randstate_t state, size_t *count) {
+	sample_stratum *strata = NULL, *st;
+	size_t n = 0, total = 0, size = 0, s, j, b, m, *share;
+	unsigned long long *rem;
+	unsigned char *buf = NULL;
+	unsigned long bits;
+	long len;
+	int neg;
+	mpz_t x;
+
+	if (k == 0)
+		return 0;
+
+	mpz_init(x);
+	while ((len = sample_read(in, &buf, &size, &neg)) >= 0) {
+		bits = sample_bits(buf, len);
+		if (bits < min_bits || (max_bits > 0 && bits > max_bits))
+			continue;
+		total++;
+
+		s = width > 0 ? bits / width : 0;
+		if (s >= n) {
+			strata = (sample_stratum *)realloc(strata, (s + 1) * sizeof(sample_stratum));
+			for (; n <= s; n++) {
+				strata[n].reservoir.array = NULL;
+				strata[n].seen = 0;
+			}
+		}
+		st = &strata[s];
+		st->seen++;
+
+		// Fill the reservoir, afterwards replace a random integer with
+		// probability k / seen.
+		if (st->seen <= k) {
+			if (st->reservoir.array == NULL)
+				array_init(&st->reservoir, k);
+			mpz_import(x, (size_t)len, 1, 1, 1, 0, buf);
+			if (neg) mpz_neg(x, x);
+			array_add(&st->reservoir, x);
+		} else if ((j = gmp_urandomm_ui(state, st->seen)) < k) {
+			mpz_import(st->reservoir.array[j], (size_t)len, 1, 1, 1, 0, buf);
+			if (neg) mpz_neg(st->reservoir.array[j], st->reservoir.array[j]);
+		}
+	}
+	mpz_clear(x);
+	free(buf);
+
+	// Share the sample by the counts of the strata, the rest of the integer
+	// division goes to the strata with the largest remainders.
+	m = total < k ? total : k;
+	share = (size_t *)calloc(n + 1, sizeof(size_t));
+	rem = (unsigned long long *)calloc(n + 1, sizeof(unsigned long long));
+	for (s = 0, j = 0; s < n; s++) {
+		share[s] = (size_t)((unsigned long long)strata[s].seen * m / total);
+		rem[s] = (unsigned long long)strata[s].seen * m % total;
+		j += share[s];
+	}
+	for (; j < m; j++) {
+		for (s = 0, b = n; s < n; s++) {
+			if (share[s] < strata[s].reservoir.used && (b == n || rem[s] > rem[b]))
+				b = s;
+		}
+		share[b]++;
+		rem[b] = 0;
+	}
+	free(rem);
+
+	j = sample->used;
+	for (s = 0; s < n; s++) {
+		if (strata[s].reservoir.array == NULL)
+			continue;
+		sample_take(sample, &strata[s].reservoir, share[s], state);
+		array_clear(&strata[s].reservoir);
+	}
+	free(share);
+	free(strata);
+
+	if (count != NULL)
+		*count = total;
+	return sample->used - j;
+}
@@ -0,0 +1,16 @@
+// copri, Attacking RSA by factoring coprimes
+//
+// License: GNU Lesser General Public License (LGPL), version 3 or later
+// See the lgpl.txt file in the root directory or <https://www.gnu.org/licenses/lgpl>.
+
+#ifndef SAMPLE_H
+#define SAMPLE_H
+
+#include <stdio.h>
+#include <gmp.h>
+#include "array.h"
+
+size_t array_sample_stdio(mpz_array *sample, FILE *in, size_t k, unsigned long width,
+	unsigned long min_bits, unsigned long max_bits, gmp_randstate_t state, size_t *count);
+
+#endif /* SAMPLE_H */
@@ -0,0 +1,90 @@
+// copri, Attacking RSA by factoring coprimes
+//
+// License: GNU Lesser General Public License (LGPL), version 3 or later
+// See the lgpl.txt file in the root directory or <https://www.gnu.org/licenses/lgpl>.
+
+// Attribution of keys to the CSV they were converted from.
+//
+// `csv2gmp -s FILE` writes the byte offset of the CSV line of every key it
+// writes to FILE. Record `i` of the raw GMP file came from the line at
+// offset `i` of the sidecar, so a result is looked up in the CSV by a
+// single seek instead of a scan for its decimal value. The sidecar has no
+// header, it is a plain list of 8 byte unsigned little endian offsets.
+// Like the GMP file it is appended to, so both grow in step as long as
+// they are always written together.
+//
+// See [source test](test-source.html) for basic usage.
+#define _FILE_OFFSET_BITS 64
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "source.h"
+
+// Append `n` offsets to `out`. Returns the number of offsets written.
+size_t source_write(FILE *out, const uint64_t *offsets, size_t n) {
+	unsigned char b[8 * 512];
+	size_t i, j, k, done = 0;
+
+	for (i = 0; i < n; i += k) {
+		k = n - i < 512 ? n - i : 512;
+		for (j = 0; j < 8 * k; j++)
+			b[j] = (unsigned char)(offsets[i + j / 8] >> (8 * (j % 8)));
+		if (fwrite(b, 8, k, out) != k)
+			break;
+		done += k;
+	}
+	return done;
+}
+
+// Map the sidecar `filename`. Returns 0 if it can't be read.
+int source_open(source_map *x, const char *filename) {
+	struct stat st;
+	void *map;
+	int fd;
+
+	memset(x, 0, sizeof(source_map));
+	if ((fd = open(filename, O_RDONLY)) < 0)
+		return 0;
+	if (fstat(fd, &st) != 0 || st.st_size % 8 != 0) {
+		close(fd);
+		return 0;
+	}
+	// An empty sidecar is valid, but can't be mapped.
+	if (st.st_size == 0) {
+		close(fd);
+		return 1;
+	}
+	map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return 0;
+	x->map = (const unsigned char *)map;
+	x->map_size = (size_t)st.st_size;
+	x->count = x->map_size / 8;
+	return 1;
+}
+
+void source_close(source_map *x) {
+	if (x->map != NULL)
+		munmap((void *)x->map, x->map_size);
+	memset(x, 0, sizeof(source_map));
+}
+
+// The CSV offset of record `i`, `SOURCE_NONE` if the sidecar is shorter.
+uint64_t source_offset(source_map *x, size_t i) {
+	const unsigned char *p;
+	uint64_t v = 0;
+	int k;
+
+	if (i >= x->count)
+		return SOURCE_NONE;
+	p = x->map + 8 * i;
+	for (k = 7; k >= 0; k--)
+		v = (v << 8) | p[k];
+	return v;
+}
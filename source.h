@@ -0,0 +1,29 @@
+// copri, Attacking RSA by factoring coprimes
+//
+// License: GNU Lesser General Public License (LGPL), version 3 or later
+// See the lgpl.txt file in the root directory or <https://www.gnu.org/licenses/lgpl>.
+
+#ifndef SOURCE_H
+#define SOURCE_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+// Returned by `source_offset` for records without a source.
+#define SOURCE_NONE ((uint64_t)-1)
+
+typedef struct {
+	const unsigned char *map;
+	size_t map_size;
+	size_t count;
+} source_map;
+
+size_t source_write(FILE *out, const uint64_t *offsets, size_t n);
+
+int source_open(source_map *x, const char *filename);
+
+void source_close(source_map *x);
+
+uint64_t source_offset(source_map *x, size_t i);
+
+#endif /* SOURCE_H */
@@ -0,0 +1,211 @@
+// copri, Attacking RSA by factoring coprimes
+//
+// License: GNU Lesser General Public License (LGPL), version 3 or later
+// See the lgpl.txt file in the root directory or <https://www.gnu.org/licenses/lgpl>.
+
+// Statistics of a stream of integers in a single pass and constant memory:
+// the bit sizes, an estimate of the unique integers by a HyperLogLog sketch
+// over the [limb hash](hash.html) and the rate of integers with a small
+// prime factor.
+//
+// See [stats test](test-stats.html) for basic usage.
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <stdint.h>
+#include <math.h>
+#include <gmp.h>
+#include "stats.h"
+#include "hash.h"
+#include "primes.h"
+#include "config.h"
+#if USE_OPENMP
+#include <omp.h>
+#endif
+
+#define STATS_HLL_SIZE (1 << STATS_HLL_BITS)
+
+static unsigned long gcd_ui(unsigned long a, unsigned long b) {
+	unsigned long t;
+	while (b != 0) {
+		t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+// Start empty statistics. The primes below `bound` are multiplied into
+// products which fit into an `unsigned long`, so an integer is screened by
+// one remainder per product.
+void stats_init(stream_stats *st, unsigned long bound) {
+	mpz_array primes;
+	unsigned long p, q;
+	size_t i;
+
+	memset(st, 0, sizeof(stream_stats));
+	array_init(&primes, 10);
+	primes_sieve(&primes, bound);
+	st->products = (unsigned long *)malloc((primes.used + 1) * sizeof(unsigned long));
+	for (i = 0; i < primes.used; ) {
+		p = 1;
+		while (i < primes.used && (q = mpz_get_ui(primes.array[i])) <= ULONG_MAX / p) {
+			p *= q;
+			i++;
+		}
+		st->products[st->product_count++] = p;
+	}
+	array_clear(&primes);
+}
+
+void stats_clear(stream_stats *st) {
+	free(st->histogram);
+	free(st->products);
+	memset(st, 0, sizeof(stream_stats));
+}
+
+// Test if `x` has a prime factor below the bound.
+static int stats_small(const stream_stats *st, const mpz_t x) {
+	size_t i;
+	unsigned long r;
+
+	for (i = 0; i < st->product_count; i++) {
+		r = mpz_fdiv_ui(x, st->products[i]);
+		if (r == 0 || gcd_ui(st->products[i], r) > 1)
+			return 1;
+	}
+	return 0;
+}
+
+// Count the bit size in the histogram.
+static void stats_bits(stream_stats *st, size_t bits, size_t n) {
+	size_t size;
+
+	if (bits >= st->histogram_size) {
+		size = st->histogram_size ? st->histogram_size : 64;
+		while (size <= bits) size *= 2;
+		st->histogram = (size_t *)realloc(st->histogram, size * sizeof(size_t));
+		memset(st->histogram + st->histogram_size, 0, (size - st->histogram_size) * sizeof(size_t));
+		st->histogram_size = size;
+	}
+	st->histogram[bits] += n;
+	if (st->min_bits == 0 || bits < st->min_bits)
+		st->min_bits = bits;
+	if (bits > st->max_bits)
+		st->max_bits = bits;
+}
+
+// Add an integer to the statistics.
+void stats_add(stream_stats *st, const mpz_t x) {
+	uint64_t h = mpz_hash(x), w;
+	size_t bits = mpz_sizeinbase(x, 2), r = h >> (64 - STATS_HLL_BITS);
+	unsigned char rank = 1;
+
+	st->count++;
+	st->sum_bits += bits;
+	stats_bits(st, bits, 1);
+	if (mpz_sgn(x) < 0)
+		st->negative++;
+	if (stats_small(st, x))
+		st->small++;
+
+	// The register is selected by the top bits of the hash, its rank is
+	// the position of the first one in the other bits.
+	for (w = h << STATS_HLL_BITS; rank <= 64 - STATS_HLL_BITS && !(w & (1ULL << 63)); w <<= 1)
+		rank++;
+	if (st->hll[r] < rank)
+		st->hll[r] = rank;
+}
+
+// Add the statistics `other` to `st`.
+void stats_merge(stream_stats *st, const stream_stats *other) {
+	size_t i;
+
+	st->count += other->count;
+	st->sum_bits += other->sum_bits;
+	st->negative += other->negative;
+	st->small += other->small;
+	for (i = 0; i < other->histogram_size; i++) {
+		if (other->histogram[i] > 0)
+			stats_bits(st, i, other->histogram[i]);
+	}
+	for (i = 0; i < STATS_HLL_SIZE; i++) {
+		if (st->hll[i] < other->hll[i])
+			st->hll[i] = other->hll[i];
+	}
+}
+
+// The estimated number of unique integers. Small counts are estimated by
+// linear counting of the empty registers.
+double stats_unique(const stream_stats *st) {
+	double m = STATS_HLL_SIZE, sum = 0, e;
+	size_t i, zeros = 0;
+
+	for (i = 0; i < STATS_HLL_SIZE; i++) {
+		sum += ldexp(1.0, -(int)st->hll[i]);
+		if (st->hll[i] == 0)
+			zeros++;
+	}
+	e = 0.7213 / (1 + 1.079 / m) * m * m / sum;
+	if (e <= 2.5 * m && zeros > 0)
+		e = m * log(m / zeros);
+	return e;
+}
+
+// Add all integers of `a`.
+size_t array_stats(stream_stats *st, mpz_array *a) {
+	size_t i;
+	for (i = 0; i < a->used; i++)
+		stats_add(st, a->array[i]);
+	return a->used;
+}
+
+// ## statistics of a stream
+//
+// Add the integers of the raw GMP stream `in`. The stream is read in blocks
+// of `STATS_BLOCK_SIZE`, every thread adds its part of a block to its own
+// statistics, which are merged at the end. Returns the number of integers
+// read.
+size_t array_stats_stdio(stream_stats *st, FILE *in) {
+	stream_stats *local;
+	mpz_array block;
+	size_t i, n, count = 0;
+	int t, threads = 1;
+
+#if USE_OPENMP
+	threads = omp_get_max_threads();
+#endif
+	local = (stream_stats *)malloc(threads * sizeof(stream_stats));
+	for (t = 0; t < threads; t++) {
+		memset(&local[t], 0, sizeof(stream_stats));
+		// Share the products of the small primes.
+		local[t].products = st->products;
+		local[t].product_count = st->product_count;
+	}
+
+	array_init(&block, STATS_BLOCK_SIZE);
+	while ((n = array_read_stdio(&block, in, STATS_BLOCK_SIZE)) > 0) {
+#if USE_OPENMP
+		#pragma omp parallel for schedule(static)
+#endif
+		for (i = 0; i < n; i++) {
+#if USE_OPENMP
+			stats_add(&local[omp_get_thread_num()], block.array[i]);
+#else
+			stats_add(&local[0], block.array[i]);
+#endif
+		}
+		count += n;
+		array_clear(&block);
+		array_init(&block, STATS_BLOCK_SIZE);
+	}
+	array_clear(&block);
+
+	for (t = 0; t < threads; t++) {
+		stats_merge(st, &local[t]);
+		free(local[t].histogram);
+	}
+	free(local);
+	return count;
+}
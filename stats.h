@@ -0,0 +1,51 @@
+// copri, Attacking RSA by factoring coprimes
+//
+// License: GNU Lesser General Public License (LGPL), version 3 or later
+// See the lgpl.txt file in the root directory or <https://www.gnu.org/licenses/lgpl>.
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+#include <gmp.h>
+#include "array.h"
+
+// The HyperLogLog sketch has 2^STATS_HLL_BITS registers, its standard
+// error is 1.04 / sqrt(2^STATS_HLL_BITS), about 0.8%.
+#define STATS_HLL_BITS 14
+
+// Integers with a prime factor below this bound count as small factor.
+#define STATS_SMALL_BOUND 1000
+
+// Integers read per block of `array_stats_stdio`.
+#define STATS_BLOCK_SIZE 65536
+
+typedef struct {
+	size_t count;
+	size_t min_bits;
+	size_t max_bits;
+	unsigned long long sum_bits;
+	size_t *histogram;
+	size_t histogram_size;
+	size_t negative;
+	size_t small;
+	unsigned long *products;
+	size_t product_count;
+	unsigned char hll[1 << STATS_HLL_BITS];
+} stream_stats;
+
+void stats_init(stream_stats *st, unsigned long bound);
+
+void stats_clear(stream_stats *st);
+
+void stats_add(stream_stats *st, const mpz_t x);
+
+void stats_merge(stream_stats *st, const stream_stats *other);
+
+double stats_unique(const stream_stats *st);
+
+size_t array_stats(stream_stats *st, mpz_array *a);
+
+size_t array_stats_stdio(stream_stats *st, FILE *in);
+
+#endif /* STATS_H */
@@ -149,6 +149,68 @@ static char * test_msort_2() {
 	return 0;
 }
 
+// Test sort of random integers with equal prefixes, duplicates, zeros and
+// negative values, large enough to be sorted in parallel.
+static char * test_msort_random() {
+	mpz_array a;
+	gmp_randstate_t state;
+	mpz_t p, q;
+	size_t g, count = 50000;
+	mpz_t sum_before, sum_after;
+
+	gmp_randinit_default(state);
+	mpz_init(p);
+	mpz_init(q);
+	mpz_init_set_ui(sum_before, 0);
+	mpz_init_set_ui(sum_after, 0);
+	array_init(&a, 4);
+
+	for(g=0;g<count;g++) {
+		switch (g % 5) {
+		case 0:
+			// Equal top 64 bits, different low bits.
+			mpz_set_ui(p, 0xabcdef);
+			mpz_mul_2exp(p, p, 1000);
+			mpz_urandomb(q, state, 64);
+			mpz_add(p, p, q);
+			break;
+		case 1:
+			mpz_urandomb(p, state, 1 + g % 300);
+			break;
+		case 2:
+			mpz_urandomb(p, state, 1 + g % 200);
+			mpz_neg(p, p);
+			break;
+		case 3:
+			mpz_set_ui(p, g % 7);
+			break;
+		default:
+			mpz_urandomb(p, state, 2048);
+		}
+		mpz_add(sum_before, sum_before, p);
+		array_add(&a, p);
+	}
+
+	array_msort(&a);
+
+	if (a.used != count) return "wrong size";
+	for(g=0;g<a.used;g++) {
+		mpz_add(sum_after, sum_after, a.array[g]);
+		if (g > 0 && mpz_cmp(a.array[g-1], a.array[g]) > 0)
+			return "not sorted";
+	}
+	if (mpz_cmp(sum_before, sum_after) != 0) return "integers changed";
+
+	array_clear(&a);
+	mpz_clear(p);
+	mpz_clear(q);
+	mpz_clear(sum_before);
+	mpz_clear(sum_after);
+	gmp_randclear(state);
+
+	return 0;
+}
+
 // Creates an array and add 10 integers and validate all values.
 // Finally free the memory of the array.
 static char * test_copy() {
@@ -332,6 +394,9 @@ int main(int argc, char **argv) {
 	printf("Testing msort_2                ");
 	test_evaluate(test_msort_2());
 
+	printf("Testing msort random           ");
+	test_evaluate(test_msort_random());
+
 	printf("Testing equal                  ");
 	test_evaluate(test_equal());
 
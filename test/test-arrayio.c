@@ -67,6 +67,32 @@ static char * test_of_file() {
 	return 0;
 }
 
+// Reads the file in blocks of 3 values.
+static char * test_read_blocks() {
+	mpz_array a, b;
+	size_t count, i, total = 0;
+	FILE *in;
+	array_init(&a, 3);
+	array_init(&b, 8);
+	add_test_data(&b);
+	in = fopen("test/test.lst", "r");
+	if (in == NULL) return "Can't read test/test.lst";
+	while ((count = array_read_stdio(&a, in, 3)) > 0) {
+		if (a.used != count) return "Array size and read count do not match";
+		if (count > 3) return "Block is too large";
+		for (i = 0; i < a.used; i++) {
+			if (total >= b.used || mpz_cmp(a.array[i], b.array[total++]) != 0)
+				return "Block does not contain the test data";
+		}
+		array_clear(&a);
+		array_init(&a, 3);
+	}
+	fclose(in);
+	if (total != b.used) return "Wrong total count";
+	array_clear(&a);
+	array_clear(&b);
+	return 0;
+}
 
 // Execute all tests.
 int main(int argc, char** argv) {
@@ -78,6 +104,9 @@ int main(int argc, char** argv) {
 
 	printf("Testing array_of_file          ");
 	test_evaluate(test_of_file());
+
+	printf("Testing array_read_stdio       ");
+	test_evaluate(test_read_blocks());
 	
 	test_end();
 }
@@ -9,6 +9,11 @@
 #include <gmp.h>
 #include "test.h"
 #include "copri.h"
+#include "memory.h"
+#include "config.h"
+#if USE_OPENMP
+#include <omp.h>
+#endif
 
 int tests_passed = 0;
 int tests_failed = 0;
@@ -59,6 +64,160 @@ static char * test() {
 	return 0;
 }
 
+// **Test `array_cb_buckets`** on integers of 10, 20 and 30 bits.
+static char * test_buckets() {
+	mpz_array in, out, array_expect;
+	mpz_t b;
+	mpz_pool pool;
+
+	pool_init(&pool, 0);
+	array_init(&in, 10);
+	array_init(&out, 3);
+	array_init(&array_expect, 3);
+
+	// primes: 577, 727, 863, 1031
+	mpz_init_set_str(b, "577", 10);
+	array_add(&in, b);
+	mpz_set_str(b, "419479", 10); // 727 * 577
+	array_add(&in, b);
+	mpz_set_str(b, "627401", 10); // 727 * 863
+	array_add(&in, b);
+	mpz_set_str(b, "646850431", 10); // 727 * 863 * 1031
+	array_add(&in, b);
+
+	array_cb(&pool, &array_expect, &in);
+	array_msort(&array_expect);
+
+	array_cb_buckets(&pool, &out, &in, 10);
+	array_msort(&out);
+
+	if (out.used != 4 || !array_equal(&array_expect, &out)) {
+		return "out and array_expect differ!";
+	}
+
+	mpz_clear(b);
+	array_clear(&in);
+	array_clear(&out);
+	array_clear(&array_expect);
+	pool_clear(&pool);
+
+	return 0;
+}
+
+// **Test `cb` with arenas** on the products of `n` pairs of neighbouring
+// primes. The base of more than 128 primes makes `cbmerge` reduce its
+// products by `array_divide_conquer` inside an arena scope.
+static char * test_arena(size_t n) {
+	mpz_array in, out, array_expect;
+	mpz_t b, q;
+	mpz_pool pool;
+	size_t i;
+
+	memory_arena_init(1 << 24);
+	pool_init(&pool, 0);
+	array_init(&in, n);
+	array_init(&out, n + 1);
+	array_init(&array_expect, n + 1);
+
+	mpz_init(b);
+	mpz_init(q);
+	mpz_ui_pow_ui(q, 2, 256);
+	mpz_nextprime(q, q);
+	array_add(&array_expect, q);
+	for (i = 0; i < n; i++) {
+		mpz_set(b, q);
+		mpz_nextprime(q, q);
+		array_add(&array_expect, q);
+		mpz_mul(b, b, q);
+		array_add(&in, b);
+	}
+
+	array_cb(&pool, &out, &in);
+
+	array_msort(&out);
+	array_msort(&array_expect);
+	if (!array_equal(&array_expect, &out)) {
+		return "out and array_expect differ!";
+	}
+
+	mpz_clear(b);
+	mpz_clear(q);
+	array_clear(&in);
+	array_clear(&out);
+	array_clear(&array_expect);
+	pool_clear(&pool);
+
+	return 0;
+}
+
+// **Test `cb` with arenas on large integers**: the products of `n` pairs
+// of neighbouring primes raised to `e`, the base are the powers of the
+// primes. The products of `cbmerge` exceed
+// the initial size of the pool integers, so GMP moves their limbs while
+// the arena is active.
+static char * test_arena_big(size_t n, unsigned long e) {
+	mpz_array in, out, array_expect;
+	mpz_t b, q;
+	mpz_pool pool;
+	size_t i;
+
+	memory_arena_init(1 << 24);
+	pool_init(&pool, 0);
+	array_init(&in, n);
+	array_init(&out, n + 1);
+	array_init(&array_expect, n + 1);
+
+	mpz_init(b);
+	mpz_init(q);
+	mpz_ui_pow_ui(q, 2, 64);
+	mpz_nextprime(q, q);
+	mpz_pow_ui(b, q, e);
+	array_add(&array_expect, b);
+	for (i = 0; i < n; i++) {
+		mpz_set(b, q);
+		mpz_nextprime(q, q);
+		mpz_mul(b, b, q);
+		mpz_pow_ui(b, b, e);
+		array_add(&in, b);
+		mpz_pow_ui(b, q, e);
+		array_add(&array_expect, b);
+	}
+
+	array_cb(&pool, &out, &in);
+
+	array_msort(&out);
+	array_msort(&array_expect);
+	if (!array_equal(&array_expect, &out)) {
+		return "out and array_expect differ!";
+	}
+
+	mpz_clear(b);
+	mpz_clear(q);
+	array_clear(&in);
+	array_clear(&out);
+	array_clear(&array_expect);
+	pool_clear(&pool);
+
+	return 0;
+}
+
+// **Test `cb` with arenas and nested threads**: the buffers of
+// `array_divide_conquer` inside a `cbmerge` scope are written by the
+// threads of a nested team.
+static char * test_arena_threads(size_t n) {
+	char *msg;
+#if USE_OPENMP
+	int levels = omp_get_max_active_levels(), threads = omp_get_max_threads();
+	omp_set_max_active_levels(3);
+	omp_set_num_threads(8);
+#endif
+	msg = test_arena(n);
+#if USE_OPENMP
+	omp_set_max_active_levels(levels);
+	omp_set_num_threads(threads);
+#endif
+	return msg;
+}
 
 // Run all tests.
 int main(int argc, char **argv) {
@@ -68,5 +227,23 @@ int main(int argc, char **argv) {
 	printf("Test1                          ");
 	test_evaluate(test());
 
+	printf("Test1 split by bits            ");
+	set_split_mode(SPLIT_BITS);
+	test_evaluate(test());
+	set_split_mode(SPLIT_COUNT);
+
+	printf("Test buckets                   ");
+	test_evaluate(test_buckets());
+
+	// The arena stays enabled, so these tests run last.
+	printf("Test arena 300                 ");
+	test_evaluate(test_arena(300));
+
+	printf("Test arena large integers      ");
+	test_evaluate(test_arena_big(40, 1024));
+
+	printf("Test arena nested threads      ");
+	test_evaluate(test_arena_threads(300));
+
 	test_end();
 }
@@ -7,7 +7,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <gmp.h>
-#include <time.h>
+#include <string.h>
 #include "test.h"
 #include "copri.h"
 #include "divide_conquer.h"
@@ -19,13 +19,12 @@ void test_merge_mul_func(mpz_pool *pool, mpz_t ret, const mpz_t a, const mpz_t b
 	mpz_mul(ret, a, b);
 }
 
-// Test divide_conquer by factorial.
+// Test divide_conquer by factorial against the recursive `prod`.
 static char * test_merge_mul(size_t n) {
 	mpz_array a;
 	mpz_t p, x;
 	size_t g;
 	mpz_pool pool;
-	clock_t begin_divide_conquer, end_divide_conquer, end_array_prod, iterative_clock, recursive_clock;
 
 	mpz_init(p);
 	mpz_init(x);
@@ -37,28 +36,112 @@ static char * test_merge_mul(size_t n) {
 		array_add(&a, p);
 	}
 
-	begin_divide_conquer = clock();
 	array_divide_conquer(&pool, x, &a, &test_merge_mul_func);
-	end_divide_conquer = clock();
-	array_prod(&pool, &a, p);
-	end_array_prod = clock();
+	prod(&pool, p, a.array, 0, a.used - 1);
 
 	if (mpz_cmp(p, x) != 0) {
 		return "ret value is wrong";
 	}
 
-	iterative_clock = end_divide_conquer - begin_divide_conquer;
-	recursive_clock = end_array_prod - end_divide_conquer;
+	array_clear(&a);
+	mpz_clear(p);
+	mpz_clear(x);
+	pool_clear(&pool);
+
+	return 0;
+}
+
+// Append the decimal digits of `b` to `a`. This is associative but not
+// commutative, so the order of the leaves is checked.
+void test_merge_concat_func(mpz_pool *pool, mpz_t ret, const mpz_t a, const mpz_t b) {
+	mpz_t t;
+	char *digits = mpz_get_str(NULL, 10, b);
+
+	mpz_init(t);
+	mpz_ui_pow_ui(t, 10, strlen(digits));
+	mpz_mul(t, a, t);
+	mpz_add(ret, t, b);
+	mpz_clear(t);
+	free(digits);
+}
 
-	if (iterative_clock > recursive_clock) {
-		printf("WARN: slower (%ju) ", (clock_t)(iterative_clock-recursive_clock));
+// Test the order of the merges by concatenating the digits 1 to 9 `n` times.
+static char * test_merge_concat(size_t n) {
+	mpz_array a;
+	mpz_t x, expected;
+	mpz_pool pool;
+	char *s;
+	size_t g;
+
+	mpz_init(x);
+	array_init(&a, n);
+	pool_init(&pool, 1);
+	s = (char *)malloc(n + 1);
+	for (g = 0; g < n; g++) {
+		s[g] = '1' + g % 9;
+		mpz_set_ui(x, 1 + g % 9);
+		array_add(&a, x);
 	}
+	s[n] = '\0';
+	mpz_init_set_str(expected, s, 10);
+
+	array_divide_conquer(&pool, x, &a, &test_merge_concat_func);
+	test_assert("wrong order", mpz_cmp(x, expected) == 0);
 
+	free(s);
 	array_clear(&a);
-	mpz_clear(p);
 	mpz_clear(x);
+	mpz_clear(expected);
 	pool_clear(&pool);
+	return 0;
+}
 
+void test_bases_leaf(mpz_pool *pool, mpz_array *ret, mpz_t *s, size_t i) {
+	array_add(ret, s[i]);
+}
+
+// Append the base `q` to `p`, like `test_merge_concat_func` for arrays.
+void test_bases_merge(mpz_pool *pool, mpz_array *ret, mpz_array *p, mpz_array *q,
+mpz_t *s, size_t from, size_t to, int depth) {
+	array_add_array(ret, p);
+	array_add_array(ret, q);
+}
+
+// Split off the first integer, which degenerates the tree to a list.
+size_t test_bases_split_first(mpz_t *s, size_t from, size_t to) {
+	return from;
+}
+
+// Split off the last integer.
+size_t test_bases_split_last(mpz_t *s, size_t from, size_t to) {
+	return to - 1;
+}
+
+// Test the order and the height of `divide_conquer_bases`.
+static char * test_bases(size_t n, dc_split_func split, size_t height) {
+	mpz_array a, r;
+	mpz_pool pool;
+	mpz_t x;
+	size_t g;
+
+	mpz_init(x);
+	array_init(&a, n);
+	array_init(&r, 1);
+	pool_init(&pool, 1);
+	for (g = 0; g < n; g++) {
+		mpz_set_ui(x, g);
+		array_add(&a, x);
+	}
+
+	test_assert("wrong height", divide_conquer_bases(&pool, &r, a.array, 0, n - 1, split, test_bases_leaf, test_bases_merge) == height);
+	test_assert("wrong length", r.used == n);
+	for (g = 0; g < n; g++)
+		test_assert("wrong order", mpz_cmp_ui(r.array[g], g) == 0);
+
+	array_clear(&a);
+	array_clear(&r);
+	mpz_clear(x);
+	pool_clear(&pool);
 	return 0;
 }
 
@@ -79,5 +162,32 @@ int main(int argc, char **argv) {
 	printf("Testing mul 130                ");
 	test_evaluate(test_merge_mul(130));
 
+	printf("Testing mul 20000              ");
+	test_evaluate(test_merge_mul(20000));
+
+	printf("Testing order 3                ");
+	test_evaluate(test_merge_concat(3));
+
+	printf("Testing order 1001             ");
+	test_evaluate(test_merge_concat(1001));
+
+	printf("Testing bases 1                ");
+	test_evaluate(test_bases(1, NULL, 0));
+
+	printf("Testing bases 4                ");
+	test_evaluate(test_bases(4, NULL, 2));
+
+	printf("Testing bases 1001             ");
+	test_evaluate(test_bases(1001, NULL, 10));
+
+	printf("Testing bases list 1001        ");
+	test_evaluate(test_bases(1001, test_bases_split_first, 1000));
+
+	printf("Testing bases last 1001        ");
+	test_evaluate(test_bases(1001, test_bases_split_last, 1000));
+
+	printf("Testing bases 100000           ");
+	test_evaluate(test_bases(100000, NULL, 17));
+
 	test_end();
 }
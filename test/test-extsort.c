@@ -0,0 +1,109 @@
+// copri, Attacking RSA by factoring coprimes
+//
+// License: GNU Lesser General Public License (LGPL), version 3 or later
+// See the lgpl.txt file in the root directory or <https://www.gnu.org/licenses/lgpl>.
+
+// This is a test of the [external sort](extsort.html).
+#include <stdlib.h>
+#include <stdio.h>
+#include <gmp.h>
+#include "test.h"
+#include "extsort.h"
+
+int tests_passed = 0;
+int tests_failed = 0;
+
+// Write 3000 integers with duplicates and of different sizes to `in` and
+// to the array `a`.
+static void test_input(FILE *in, mpz_array *a) {
+	mpz_t x;
+	size_t i;
+
+	mpz_init(x);
+	for (i = 0; i < 3000; i++) {
+		mpz_set_ui(x, (i * 7919) % 1000);
+		mpz_mul_2exp(x, x, 64 * (i % 5));
+		if (i % 7 == 0)
+			mpz_neg(x, x);
+		mpz_out_raw(in, x);
+		array_add(a, x);
+	}
+	mpz_clear(x);
+	rewind(in);
+}
+
+// Compare the stream `out` with the array `a`.
+static int test_equal(FILE *out, mpz_array *a) {
+	mpz_array b;
+	int r;
+
+	rewind(out);
+	array_init(&b, 10);
+	array_read_stdio(&b, out, a->used + 1);
+	r = array_equal(a, &b);
+	array_clear(&b);
+	return r;
+}
+
+// **Test sorting in a single run** without temporary files.
+static char * test_single() {
+	mpz_array a;
+	FILE *in = tmpfile(), *out = tmpfile();
+	size_t count;
+
+	array_init(&a, 10);
+	test_input(in, &a);
+	array_msort(&a);
+	test_assert("wrong write count", array_extsort(in, out, 1 << 30, 0, &count) == 3000);
+	test_assert("wrong read count", count == 3000);
+	test_assert("wrong order", test_equal(out, &a));
+
+	fclose(in);
+	fclose(out);
+	array_clear(&a);
+	return 0;
+}
+
+// **Test merging runs** in two passes, the small budget creates more than
+// `EXTSORT_MAX_RUNS` runs.
+static char * test_runs() {
+	mpz_array a, uniques;
+	FILE *in = tmpfile(), *out = tmpfile();
+	size_t count;
+
+	array_init(&a, 10);
+	array_init(&uniques, 10);
+	test_input(in, &a);
+	array_msort(&a);
+	array_unique(&uniques, &a);
+
+	test_assert("wrong write count", array_extsort(in, out, 1000, 0, &count) == 3000);
+	test_assert("wrong order", test_equal(out, &a));
+
+	rewind(in);
+	fclose(out);
+	out = tmpfile();
+	test_assert("wrong unique count", array_extsort(in, out, 1000, 1, &count) == uniques.used);
+	test_assert("wrong read count", count == 3000);
+	test_assert("wrong uniques", test_equal(out, &uniques));
+
+	fclose(in);
+	fclose(out);
+	array_clear(&a);
+	array_clear(&uniques);
+	return 0;
+}
+
+// Execute all tests.
+int main(int argc, char **argv) {
+
+	printf("Starting extsort test\n");
+
+	printf("Testing single run             ");
+	test_evaluate(test_single());
+
+	printf("Testing runs                   ");
+	test_evaluate(test_runs());
+
+	test_end();
+}
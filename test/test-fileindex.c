@@ -0,0 +1,175 @@
+// copri, Attacking RSA by factoring coprimes
+//
+// License: GNU Lesser General Public License (LGPL), version 3 or later
+// See the lgpl.txt file in the root directory or <https://www.gnu.org/licenses/lgpl>.
+
+// This is a test of the [index sidecar](fileindex.html) of raw GMP files.
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <gmp.h>
+#include "test.h"
+#include "fileindex.h"
+
+int tests_passed = 0;
+int tests_failed = 0;
+
+// The integer at index `i` of the test file, of different sizes and signs.
+static void test_value(mpz_t x, size_t i) {
+	mpz_ui_pow_ui(x, 3, 1 + (i * 37) % 500);
+	if (i % 5 == 0)
+		mpz_neg(x, x);
+}
+
+// **Test building the index** of 10000 integers.
+static char * test_build() {
+	mpz_array a;
+	mpz_t x;
+	size_t i;
+
+	array_init(&a, 10000);
+	mpz_init(x);
+	for (i = 0; i < 10000; i++) {
+		test_value(x, i);
+		array_add(&a, x);
+	}
+	unlink("test/test-index.lst");
+	array_to_file(&a, "test/test-index.lst");
+	test_assert("wrong index count", fileindex_build("test/test-index.lst") == 10000);
+	test_assert("index missing", access("test/test-index.lst" FILEINDEX_SUFFIX, R_OK) == 0);
+
+	mpz_clear(x);
+	array_clear(&a);
+	return 0;
+}
+
+// **Test reading ranges** by a single thread and in parallel.
+static char * test_range() {
+	file_index x;
+	mpz_array a;
+	mpz_t v;
+	size_t i;
+
+	test_assert("can't open the index", fileindex_open(&x, "test/test-index.lst"));
+	test_assert("wrong count", x.count == 10000);
+	mpz_init(v);
+
+	array_init(&a, 10);
+	test_assert("wrong short range", fileindex_read(&x, &a, 17, 5) == 5);
+	for (i = 0; i < a.used; i++) {
+		test_value(v, 17 + i);
+		test_assert("wrong integer in short range", mpz_cmp(v, a.array[i]) == 0);
+	}
+	array_clear(&a);
+
+	array_init(&a, 10);
+	test_assert("wrong long range", fileindex_read(&x, &a, 100, 20000) == 9900);
+	for (i = 0; i < a.used; i++) {
+		test_value(v, 100 + i);
+		test_assert("wrong integer in long range", mpz_cmp(v, a.array[i]) == 0);
+	}
+	array_clear(&a);
+
+	array_init(&a, 10);
+	test_assert("range behind the end", fileindex_read(&x, &a, 10000, 1) == 0);
+	array_clear(&a);
+
+	mpz_clear(v);
+	fileindex_close(&x);
+	return 0;
+}
+
+// **Test reading indices** in any order.
+static char * test_indices() {
+	file_index x;
+	mpz_array a;
+	mpz_t v;
+	size_t i, indices[4] = {9999, 0, 5000, 1};
+
+	test_assert("can't open the index", fileindex_open(&x, "test/test-index.lst"));
+	array_init(&a, 4);
+	mpz_init(v);
+	test_assert("wrong read count", fileindex_read_indices(&x, &a, indices, 4) == 4);
+	for (i = 0; i < 4; i++) {
+		test_value(v, indices[i]);
+		test_assert("wrong integer", mpz_cmp(v, a.array[i]) == 0);
+	}
+	mpz_clear(v);
+	array_clear(&a);
+	fileindex_close(&x);
+	return 0;
+}
+
+// **Test a rewritten file**: the integers change their signs, so the file
+// keeps its size but gets a later modification time.
+static char * test_rewritten() {
+	file_index x;
+	mpz_array a;
+	struct stat st;
+	struct timeval t[2];
+	mpz_t v;
+	size_t i;
+
+	test_assert("no stat", stat("test/test-index.lst", &st) == 0);
+	array_init(&a, 10000);
+	mpz_init(v);
+	for (i = 0; i < 10000; i++) {
+		test_value(v, i);
+		mpz_neg(v, v);
+		array_add(&a, v);
+	}
+	unlink("test/test-index.lst");
+	array_to_file(&a, "test/test-index.lst");
+	t[0].tv_sec = t[1].tv_sec = st.st_mtime + 10;
+	t[0].tv_usec = t[1].tv_usec = 0;
+	utimes("test/test-index.lst", t);
+	test_assert("rewritten index opened", !fileindex_open(&x, "test/test-index.lst"));
+
+	mpz_clear(v);
+	array_clear(&a);
+	return 0;
+}
+
+// **Test a stale index**: the file has grown since the index was built.
+static char * test_stale() {
+	file_index x;
+	mpz_array a;
+	mpz_t v;
+
+	array_init(&a, 1);
+	mpz_init_set_ui(v, 7);
+	array_add(&a, v);
+	array_to_file(&a, "test/test-index.lst");
+	test_assert("stale index opened", !fileindex_open(&x, "test/test-index.lst"));
+
+	unlink("test/test-index.lst");
+	unlink("test/test-index.lst" FILEINDEX_SUFFIX);
+	mpz_clear(v);
+	array_clear(&a);
+	return 0;
+}
+
+// Execute all tests.
+int main(int argc, char **argv) {
+
+	printf("Starting fileindex test\n");
+
+	printf("Testing build                  ");
+	test_evaluate(test_build());
+
+	printf("Testing range                  ");
+	test_evaluate(test_range());
+
+	printf("Testing indices                ");
+	test_evaluate(test_indices());
+
+	printf("Testing rewritten file         ");
+	test_evaluate(test_rewritten());
+
+	printf("Testing stale index            ");
+	test_evaluate(test_stale());
+
+	test_end();
+}
@@ -0,0 +1,185 @@
+// copri, Attacking RSA by factoring coprimes
+//
+// License: GNU Lesser General Public License (LGPL), version 3 or later
+// See the lgpl.txt file in the root directory or <https://www.gnu.org/licenses/lgpl>.
+
+// This is a test of the [hash](hash.html) set.
+#include <stdlib.h>
+#include <stdio.h>
+#include <gmp.h>
+#include "test.h"
+#include "hash.h"
+
+int tests_passed = 0;
+int tests_failed = 0;
+
+// **Test the hash** of equal and different integers.
+static char * test_hash() {
+	mpz_t a, b;
+
+	mpz_init(a);
+	mpz_init(b);
+	mpz_ui_pow_ui(a, 7, 300);
+	mpz_set(b, a);
+	mpz_realloc2(b, 4096);
+	test_assert("equal integers differ", mpz_hash(a) == mpz_hash(b));
+	mpz_neg(b, b);
+	test_assert("negative integer equal", mpz_hash(a) != mpz_hash(b));
+	mpz_neg(b, b);
+	mpz_add_ui(b, b, 1);
+	test_assert("next integer equal", mpz_hash(a) != mpz_hash(b));
+	mpz_set_ui(b, 0);
+	mpz_set_ui(a, 1);
+	test_assert("zero and one equal", mpz_hash(a) != mpz_hash(b));
+
+	mpz_clear(a);
+	mpz_clear(b);
+	return 0;
+}
+
+// **Test the set** while it grows.
+static char * test_set() {
+	mpz_array a;
+	mpz_hashset h;
+	mpz_t x;
+	size_t i;
+
+	array_init(&a, 10);
+	mpz_init(x);
+	for (i = 0; i < 1000; i++) {
+		mpz_ui_pow_ui(x, 3, i);
+		array_add(&a, x);
+	}
+	hashset_init(&h, &a, 0);
+	for (i = 0; i < a.used; i++) {
+		test_assert("integer added twice", hashset_add(&h, i) == i);
+	}
+	mpz_ui_pow_ui(x, 3, 500);
+	array_add(&a, x);
+	test_assert("duplicate not found", hashset_add(&h, a.used - 1) == 500);
+	test_assert("wrong set size", h.used == 1000);
+	test_assert("wrong index", hashset_find(&h, x) == 500);
+	mpz_ui_pow_ui(x, 5, 10);
+	test_assert("missing integer found", hashset_find(&h, x) == HASHSET_NONE);
+
+	hashset_clear(&h);
+	mpz_clear(x);
+	array_clear(&a);
+	return 0;
+}
+
+// **Test removing the duplicates** of 5, 3, 5, 1, 3, 5.
+static char * test_dedup() {
+	mpz_array a;
+	mpz_t x;
+	size_t map[6], i, n;
+	unsigned long in[6] = {5, 3, 5, 1, 3, 5};
+	size_t expected_map[6] = {0, 1, 0, 2, 1, 0};
+
+	array_init(&a, 6);
+	mpz_init(x);
+	for (i = 0; i < 6; i++) {
+		mpz_set_ui(x, in[i]);
+		array_add(&a, x);
+	}
+	n = array_dedup(&a, map);
+	test_assert("wrong unique count", n == 3 && a.used == 3);
+	test_assert("wrong order", mpz_cmp_ui(a.array[0], 5) == 0 &&
+		mpz_cmp_ui(a.array[1], 3) == 0 && mpz_cmp_ui(a.array[2], 1) == 0);
+	for (i = 0; i < 6; i++) {
+		test_assert("wrong map", map[i] == expected_map[i]);
+	}
+
+	mpz_clear(x);
+	array_clear(&a);
+	return 0;
+}
+
+// **Test removing the integers of a set** {1, 3} from 2, 3, 4, 1.
+static char * test_remove() {
+	mpz_array a, b;
+	mpz_hashset h;
+	mpz_t x;
+	size_t i;
+	unsigned long in[4] = {2, 3, 4, 1};
+
+	array_init(&a, 4);
+	array_init(&b, 2);
+	mpz_init(x);
+	for (i = 0; i < 4; i++) {
+		mpz_set_ui(x, in[i]);
+		array_add(&a, x);
+	}
+	mpz_set_ui(x, 1);
+	array_add(&b, x);
+	mpz_set_ui(x, 3);
+	array_add(&b, x);
+
+	hashset_init(&h, &b, b.used);
+	for (i = 0; i < b.used; i++)
+		hashset_add(&h, i);
+	test_assert("wrong removed count", array_remove_set(&a, &h) == 2);
+	test_assert("wrong rest", a.used == 2 && mpz_cmp_ui(a.array[0], 2) == 0 &&
+		mpz_cmp_ui(a.array[1], 4) == 0);
+
+	hashset_clear(&h);
+	mpz_clear(x);
+	array_clear(&a);
+	array_clear(&b);
+	return 0;
+}
+
+// **Test the key index** of 5, 3, 5, 1, 3, 5.
+static char * test_keyindex() {
+	mpz_array a;
+	key_index idx;
+	mpz_t x;
+	const size_t *indices;
+	size_t map[6], i;
+	unsigned long in[6] = {5, 3, 5, 1, 3, 5};
+
+	array_init(&a, 6);
+	mpz_init(x);
+	for (i = 0; i < 6; i++) {
+		mpz_set_ui(x, in[i]);
+		array_add(&a, x);
+	}
+	array_dedup(&a, map);
+	keyindex_init(&idx, &a, map, 6);
+	mpz_set_ui(x, 5);
+	test_assert("wrong count of 5", keyindex_find(&idx, x, &indices) == 3);
+	test_assert("wrong indices of 5", indices[0] == 0 && indices[1] == 2 && indices[2] == 5);
+	mpz_set_ui(x, 1);
+	test_assert("wrong count of 1", keyindex_find(&idx, x, &indices) == 1);
+	test_assert("wrong index of 1", indices[0] == 3);
+	mpz_set_ui(x, 7);
+	test_assert("missing key found", keyindex_find(&idx, x, &indices) == 0);
+
+	keyindex_clear(&idx);
+	mpz_clear(x);
+	array_clear(&a);
+	return 0;
+}
+
+// Execute all tests.
+int main(int argc, char **argv) {
+
+	printf("Starting hash test\n");
+
+	printf("Testing hash                   ");
+	test_evaluate(test_hash());
+
+	printf("Testing set                    ");
+	test_evaluate(test_set());
+
+	printf("Testing dedup                  ");
+	test_evaluate(test_dedup());
+
+	printf("Testing remove                 ");
+	test_evaluate(test_remove());
+
+	printf("Testing key index              ");
+	test_evaluate(test_keyindex());
+
+	test_end();
+}
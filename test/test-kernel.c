@@ -0,0 +1,109 @@
+// copri, Attacking RSA by factoring coprimes
+//
+// License: GNU Lesser General Public License (LGPL), version 3 or later
+// See the lgpl.txt file in the root directory or <https://www.gnu.org/licenses/lgpl>.
+
+// This is a test of the fixed-width [kernels](kernel.html).
+#include <stdlib.h>
+#include <stdio.h>
+#include <gmp.h>
+#include "test.h"
+#include "kernel.h"
+
+int tests_passed = 0;
+int tests_failed = 0;
+
+// **Test `kernel_mul`** against `mpz_mul` for all widths.
+static char * test_mul() {
+	gmp_randstate_t state;
+	mpz_t a, b, r, e;
+	unsigned long bits, i;
+
+	gmp_randinit_default(state);
+	mpz_init(a);
+	mpz_init(b);
+	mpz_init(r);
+	mpz_init(e);
+	for (bits = 512; bits <= 4096; bits *= 2) {
+		for (i = 0; i < 20; i++) {
+			mpz_urandomb(a, state, bits);
+			mpz_setbit(a, bits - 1);
+			mpz_urandomb(b, state, bits - (i % 2));
+			mpz_mul(e, a, b);
+			kernel_mul(r, a, b);
+			test_assert("wrong product", mpz_cmp(r, e) == 0);
+			mpz_mul(e, a, a);
+			kernel_mul(r, a, a);
+			test_assert("wrong square", mpz_cmp(r, e) == 0);
+			mpz_mul(e, a, b);
+			kernel_mul(a, a, b);
+			test_assert("wrong product in place", mpz_cmp(a, e) == 0);
+		}
+	}
+	mpz_clear(a);
+	mpz_clear(b);
+	mpz_clear(r);
+	mpz_clear(e);
+	gmp_randclear(state);
+	return 0;
+}
+
+// **Test `kernel_gcd`** against `mpz_gcd`, with shared primes, even
+// operands and shorter second operands.
+static char * test_gcd() {
+	gmp_randstate_t state;
+	mpz_t a, b, p, r, e;
+	unsigned long bits, i;
+
+	gmp_randinit_default(state);
+	mpz_init(a);
+	mpz_init(b);
+	mpz_init(p);
+	mpz_init(r);
+	mpz_init(e);
+	for (bits = 1024; bits <= 4096; bits *= 2) {
+		for (i = 0; i < 40; i++) {
+			mpz_urandomb(p, state, bits / 2);
+			mpz_nextprime(p, p);
+			mpz_urandomb(a, state, bits / 2);
+			mpz_mul(a, a, p);
+			mpz_setbit(a, bits - 1);
+			mpz_urandomb(b, state, bits - 64 * (i % 4));
+			if (i % 3 == 0)
+				mpz_mul(b, b, p);
+			if (i % 5 == 0)
+				mpz_mul_2exp(b, b, 3);
+			mpz_gcd(e, a, b);
+			kernel_gcd(r, a, b);
+			test_assert("wrong gcd", mpz_cmp(r, e) == 0);
+			kernel_gcd(r, b, a);
+			test_assert("wrong swapped gcd", mpz_cmp(r, e) == 0);
+			kernel_gcd(a, a, b);
+			test_assert("wrong gcd in place", mpz_cmp(a, e) == 0);
+		}
+	}
+	mpz_set_ui(b, 0);
+	kernel_gcd(r, a, b);
+	test_assert("wrong gcd with zero", mpz_cmp(r, a) == 0);
+	mpz_clear(a);
+	mpz_clear(b);
+	mpz_clear(p);
+	mpz_clear(r);
+	mpz_clear(e);
+	gmp_randclear(state);
+	return 0;
+}
+
+// Execute all tests.
+int main(int argc, char **argv) {
+
+	printf("Starting kernel test\n");
+
+	printf("Testing mul                    ");
+	test_evaluate(test_mul());
+
+	printf("Testing gcd                    ");
+	test_evaluate(test_gcd());
+
+	test_end();
+}
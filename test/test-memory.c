@@ -0,0 +1,161 @@
+// copri, Attacking RSA by factoring coprimes
+//
+// License: GNU Lesser General Public License (LGPL), version 3 or later
+// See the lgpl.txt file in the root directory or <https://www.gnu.org/licenses/lgpl>.
+
+// This is a test of the [memory](memory.html) accounting.
+#include <stdlib.h>
+#include <stdio.h>
+#include <gmp.h>
+#include "test.h"
+#include "copri.h"
+#include "memory.h"
+
+int tests_passed = 0;
+int tests_failed = 0;
+
+// **Test the counters** of a single allocation.
+static char * test_count() {
+	memory_stats before, after;
+	mpz_t a;
+
+	memory_reset();
+	memory_total(&before);
+	mpz_init2(a, 64 * 1024);
+	memory_total(&after);
+	test_assert("allocation not counted", after.allocs == before.allocs + 1);
+	test_assert("wrong current bytes", after.current >= before.current + 8 * 1024);
+	test_assert("wrong peak", after.peak >= after.current);
+
+	mpz_clear(a);
+	memory_total(&after);
+	test_assert("free not counted", after.frees == before.frees + 1);
+	test_assert("wrong current bytes after free", after.current == before.current);
+	return 0;
+}
+
+// **Test the depth peaks** of `cb`.
+static char * test_depth() {
+	mpz_array in, out;
+	mpz_pool pool;
+	mpz_t a;
+	long long depths[MEMORY_MAX_DEPTH];
+	size_t i, d;
+
+	pool_init(&pool, 0);
+	array_init(&in, 16);
+	array_init(&out, 16);
+	mpz_init(a);
+	for (i = 0; i < 16; i++) {
+		mpz_set_ui(a, 1000 + i);
+		array_add(&in, a);
+	}
+
+	memory_reset();
+	array_cb(&pool, &out, &in);
+	d = memory_depths(depths, MEMORY_MAX_DEPTH);
+	test_assert("no depth recorded", d >= 4);
+	for (i = 0; i < d; i++) {
+		test_assert("missing depth peak", depths[i] > 0);
+	}
+
+	mpz_clear(a);
+	array_clear(&in);
+	array_clear(&out);
+	pool_clear(&pool);
+	return 0;
+}
+
+// **Test an arena scope**: the kept integers are copied out, the others
+// are released.
+static char * test_arena() {
+	mpz_array keep, tmp;
+	memory_stats before, after;
+	mpz_t a;
+	size_t mark, i;
+
+	memory_arena_init(1 << 20);
+	array_init(&keep, 4);
+	array_init(&tmp, 4);
+	mpz_init(a);
+
+	memory_total(&before);
+	mark = memory_arena_begin();
+	for (i = 0; i < 100; i++) {
+		mpz_ui_pow_ui(a, 3, 100 + i);
+		array_add(&tmp, a);
+		if (i % 10 == 0)
+			array_add(&keep, a);
+	}
+	array_clear(&tmp);
+	memory_arena_end(mark, &keep, 0);
+	memory_total(&after);
+	test_assert("no arena allocations", after.arena > before.arena);
+
+	// Allocate again to overwrite the released arena.
+	mark = memory_arena_begin();
+	array_init(&tmp, 4);
+	for (i = 0; i < 100; i++) {
+		mpz_set_ui(a, i);
+		array_add(&tmp, a);
+	}
+	array_clear(&tmp);
+	memory_arena_end(mark, NULL, 0);
+
+	test_assert("wrong kept count", keep.used == 10);
+	for (i = 0; i < keep.used; i++) {
+		mpz_ui_pow_ui(a, 3, 100 + 10 * i);
+		test_assert("kept integer changed", mpz_cmp(a, keep.array[i]) == 0);
+	}
+
+	mpz_clear(a);
+	array_clear(&keep);
+	return 0;
+}
+
+// **Test hugepage blocks**: integers grow across the threshold and back.
+static char * test_huge() {
+	mpz_t a, b;
+	unsigned long p = 1000003, r;
+
+	if (!memory_huge_init(1 << 20))
+		return 0;
+	mpz_init(a);
+	mpz_init(b);
+	mpz_ui_pow_ui(a, 3, 10000000);
+	test_assert("block not mapped", memory_huge_mapped() > 0);
+	r = mpz_fdiv_ui(a, p);
+	mpz_mul(b, a, a);
+	test_assert("wrong product", mpz_fdiv_ui(b, p) == (r * r) % p);
+
+	mpz_fdiv_q_2exp(b, b, 31000000);
+	mpz_realloc2(b, 1024);
+	mpz_realloc2(a, 1 << 26);
+	test_assert("value lost", mpz_fdiv_ui(a, p) == r);
+	mpz_clear(a);
+	mpz_clear(b);
+	test_assert("block not unmapped", memory_huge_mapped() == 0);
+	return 0;
+}
+
+// Execute all tests.
+int main(int argc, char **argv) {
+
+	printf("Starting memory test\n");
+
+	memory_init();
+
+	printf("Testing counters               ");
+	test_evaluate(test_count());
+
+	printf("Testing cb depths              ");
+	test_evaluate(test_depth());
+
+	printf("Testing arena                  ");
+	test_evaluate(test_arena());
+
+	printf("Testing hugepages              ");
+	test_evaluate(test_huge());
+
+	test_end();
+}
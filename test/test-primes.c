@@ -0,0 +1,64 @@
+// copri, Attacking RSA by factoring coprimes
+//
+// License: GNU Lesser General Public License (LGPL), version 3 or later
+// See the lgpl.txt file in the root directory or <https://www.gnu.org/licenses/lgpl>.
+
+// This is a test of the [primes](primes.html) sieve.
+#include <stdlib.h>
+#include <stdio.h>
+#include <gmp.h>
+#include "test.h"
+#include "primes.h"
+
+int tests_passed = 0;
+int tests_failed = 0;
+
+// **Test the prime count** below some bounds.
+static char * test_count(unsigned long bound, size_t expect) {
+	mpz_array p;
+	size_t i;
+
+	array_init(&p, 10);
+	if (primes_sieve(&p, bound) != expect || p.used != expect) {
+		return "wrong prime count";
+	}
+	for (i = 0; i < p.used; i++) {
+		if (mpz_probab_prime_p(p.array[i], 25) == 0) {
+			return "not a prime";
+		}
+		if (i > 0 && mpz_cmp(p.array[i - 1], p.array[i]) >= 0) {
+			return "primes not ascending";
+		}
+	}
+	if (p.used > 0 && mpz_cmp_ui(p.array[p.used - 1], bound) >= 0) {
+		return "prime above the bound";
+	}
+	array_clear(&p);
+	return 0;
+}
+
+// Execute all tests.
+int main(int argc, char **argv) {
+
+	printf("Starting primes test\n");
+
+	printf("Testing primes below 2         ");
+	test_evaluate(test_count(2, 0));
+
+	printf("Testing primes below 3         ");
+	test_evaluate(test_count(3, 1));
+
+	printf("Testing primes below 8         ");
+	test_evaluate(test_count(8, 4));
+
+	printf("Testing primes below 7919      ");
+	test_evaluate(test_count(7919, 999));
+
+	printf("Testing primes below 7920      ");
+	test_evaluate(test_count(PRIMES_DEFAULT_BOUND, 1000));
+
+	printf("Testing primes below 2^16      ");
+	test_evaluate(test_count(65536, 6542));
+
+	test_end();
+}
@@ -181,5 +181,12 @@ int main(int argc, char **argv) {
 	printf("Testing array wrapper          ");
 	test_evaluate(test_array_prod());
 
+	printf("Testing 128! split by bits     ");
+	set_split_mode(SPLIT_BITS);
+	test_evaluate(test_factorial(128, "385620482362580421735677065923463640617493109590223\
+	59027882840327637340257516554356068616858850736153403005183305891634759217293226249885\
+	7766114955245039357760034644709279247692495585280000000000000000000000000000000"));
+	set_split_mode(SPLIT_COUNT);
+
 	test_end();
 }
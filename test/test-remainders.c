@@ -0,0 +1,114 @@
+// copri, Attacking RSA by factoring coprimes
+//
+// License: GNU Lesser General Public License (LGPL), version 3 or later
+// See the lgpl.txt file in the root directory or <https://www.gnu.org/licenses/lgpl>.
+
+// This is a test of [copri](copri.html) `remainders` and `screen` functions.
+#include <stdlib.h>
+#include <stdio.h>
+#include <gmp.h>
+#include "test.h"
+#include "copri.h"
+
+int tests_passed = 0;
+int tests_failed = 0;
+
+// **Test `remainders`** of 100! modulo 2..count+1 and some primes.
+static char * test(size_t count) {
+	mpz_array in, out;
+	mpz_t a, r;
+	mpz_pool pool;
+	size_t g;
+
+	pool_init(&pool, 0);
+	array_init(&in, 10);
+	array_init(&out, 10);
+	mpz_init(a);
+	mpz_init(r);
+
+	mpz_fac_ui(a, 100);
+	for (g = 0; g < count; g++) {
+		if (g % 3 == 0) {
+			mpz_set_ui(r, 1000003 + 2 * g);
+			mpz_nextprime(r, r);
+		} else {
+			mpz_set_ui(r, g + 2);
+		}
+		array_add(&in, r);
+	}
+
+	array_remainders(&pool, &out, a, &in);
+
+	if (out.used != in.used) {
+		return "wrong remainder count";
+	}
+	for (g = 0; g < in.used; g++) {
+		mpz_fdiv_r(r, a, in.array[g]);
+		if (mpz_cmp(r, out.array[g]) != 0) {
+			return "wrong remainder";
+		}
+	}
+
+	array_clear(&in);
+	array_clear(&out);
+	mpz_clear(a);
+	mpz_clear(r);
+	pool_clear(&pool);
+
+	return 0;
+}
+
+// **Test `screen`** by the product of the primes 577 and 727.
+static char * test_screen() {
+	mpz_array in, out;
+	mpz_t a, b;
+	mpz_pool pool;
+
+	pool_init(&pool, 0);
+	array_init(&in, 4);
+	array_init(&out, 4);
+	mpz_init_set_ui(a, 419479); // 577 * 727
+	mpz_init(b);
+
+	mpz_set_ui(b, 497951); // 863 * 577
+	array_add(&in, b);
+	mpz_set_ui(b, 744769); // 863 * 863
+	array_add(&in, b);
+	mpz_set_ui(b, 419479); // 577 * 727
+	array_add(&in, b);
+
+	array_screen(&pool, &out, a, &in);
+
+	if (out.used != 3 || mpz_cmp_ui(out.array[0], 577) != 0 ||
+	mpz_cmp_ui(out.array[1], 1) != 0 || mpz_cmp_ui(out.array[2], 419479) != 0) {
+		return "wrong gcd";
+	}
+
+	array_clear(&in);
+	array_clear(&out);
+	mpz_clear(a);
+	mpz_clear(b);
+	pool_clear(&pool);
+
+	return 0;
+}
+
+// Run all tests.
+int main(int argc, char **argv) {
+
+	printf("Starting remainders test\n");
+
+	printf("Testing 1                      ");
+	test_evaluate(test(1));
+
+	printf("Testing 7                      ");
+	test_evaluate(test(7));
+
+	printf("Testing 130                    ");
+	test_evaluate(test(130));
+
+	printf("Testing screen                 ");
+	test_evaluate(test_screen());
+
+	test_end();
+}
@@ -0,0 +1,79 @@
+// copri, Attacking RSA by factoring coprimes
+//
+// License: GNU Lesser General Public License (LGPL), version 3 or later
+// See the lgpl.txt file in the root directory or <https://www.gnu.org/licenses/lgpl>.
+
+// This is a test of [copri](copri.html) `rsa_find_factors` and `array_rsa_find_factors` functions.
+#include <stdlib.h>
+#include <stdio.h>
+#include <gmp.h>
+#include "test.h"
+#include "copri.h"
+
+int tests_passed = 0;
+int tests_failed = 0;
+
+// **Test `test`** against `array_find_factors`.
+static char * test() {
+	mpz_array in, base, out, array_expect;
+	mpz_t b;
+	mpz_pool pool;
+
+	pool_init(&pool, 0);
+	array_init(&in, 10);
+	array_init(&base, 10);
+	array_init(&out, 9);
+	array_init(&array_expect, 9);
+
+	// primes: 139, 223, 317, 577, 727, 863, 4513
+	mpz_init_set_str(b, "419479", 10); // 727 * 577
+	array_add(&in, b);
+	mpz_set_str(b, "30997", 10); // 139 * 223
+	array_add(&in, b);
+	mpz_set_str(b, "627401", 10); // 727 * 863
+	array_add(&in, b);
+	mpz_set_str(b, "1430621", 10); // 317 * 4513
+	array_add(&in, b);
+	mpz_set_str(b, "497951", 10); // 863 * 577
+	array_add(&in, b);
+	mpz_set_str(b, "627401", 10); // 727 * 863
+	array_add(&in, b);
+
+	array_cb(&pool, &base, &in);
+
+	array_find_factors(&pool, &array_expect, &in, &base);
+	array_rsa_find_factors(&pool, &out, &in, &base);
+
+	if (array_expect.used != 12) {
+		return "array_find_factors found the wrong number of factors";
+	}
+	if (!array_equal(&array_expect, &out)) {
+		return "out and array_expect differ!";
+	}
+
+	mpz_clear(b);
+	array_clear(&in);
+	array_clear(&base);
+	array_clear(&out);
+	array_clear(&array_expect);
+	pool_clear(&pool);
+
+	return 0;
+}
+
+
+// Run all tests.
+int main(int argc, char **argv) {
+
+	printf("Starting rsa_find_factors test\n");
+
+	printf("Test1                          ");
+	test_evaluate(test());
+
+	printf("Test1 split by bits            ");
+	set_split_mode(SPLIT_BITS);
+	test_evaluate(test());
+	set_split_mode(SPLIT_COUNT);
+
+	test_end();
+}
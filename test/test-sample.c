@@ -0,0 +1,127 @@
+// copri, Attacking RSA by factoring coprimes
+//
+// License: GNU Lesser General Public License (LGPL), version 3 or later
+// See the lgpl.txt file in the root directory or <https://www.gnu.org/licenses/lgpl>.
+
+// This is a test of the [random samples](sample.html).
+#include <stdlib.h>
+#include <stdio.h>
+#include <gmp.h>
+#include "test.h"
+#include "sample.h"
+
+int tests_passed = 0;
+int tests_failed = 0;
+
+// Write 3000 integers of 256 bits and 1000 of 1024 bits, the first one
+// negative.
+static FILE * test_input() {
+	FILE *in = tmpfile();
+	mpz_t x;
+	size_t i;
+
+	mpz_init(x);
+	for (i = 0; i < 4000; i++) {
+		mpz_set_ui(x, 1);
+		mpz_mul_2exp(x, x, i < 3000 ? 255 : 1023);
+		mpz_add_ui(x, x, i);
+		if (i == 0)
+			mpz_neg(x, x);
+		mpz_out_raw(in, x);
+	}
+	mpz_clear(x);
+	rewind(in);
+	return in;
+}
+
+// Test that the sample has no duplicates and only integers of the input.
+static int test_valid(mpz_array *sample) {
+	mpz_array sorted;
+	size_t i;
+	int r = 1;
+
+	array_init(&sorted, sample->used);
+	array_add_array(&sorted, sample);
+	array_msort(&sorted);
+	for (i = 0; i < sorted.used; i++) {
+		if (i > 0 && mpz_cmp(sorted.array[i - 1], sorted.array[i]) == 0)
+			r = 0;
+		if (mpz_cmp_ui(sorted.array[i], 0) < 0)
+			continue;
+		if (mpz_scan1(sorted.array[i], 12) != 255 && mpz_scan1(sorted.array[i], 12) != 1023)
+			r = 0;
+	}
+	array_clear(&sorted);
+	return r;
+}
+
+// **Test a sample** of 100 and a sample of the whole stream.
+static char * test_sample() {
+	mpz_array sample;
+	gmp_randstate_t state;
+	FILE *in = test_input();
+	size_t count;
+
+	gmp_randinit_default(state);
+	array_init(&sample, 10);
+	test_assert("wrong sample size", array_sample_stdio(&sample, in, 100, 0, 0, 0, state, &count) == 100);
+	test_assert("wrong count", count == 4000);
+	test_assert("invalid sample", test_valid(&sample));
+	array_clear(&sample);
+
+	rewind(in);
+	array_init(&sample, 10);
+	test_assert("wrong short sample", array_sample_stdio(&sample, in, 5000, 0, 0, 0, state, &count) == 4000);
+	test_assert("invalid short sample", test_valid(&sample));
+	array_clear(&sample);
+
+	gmp_randclear(state);
+	fclose(in);
+	return 0;
+}
+
+// **Test a stratified sample** and a filtered sample.
+static char * test_strata() {
+	mpz_array sample;
+	gmp_randstate_t state;
+	FILE *in = test_input();
+	size_t count, i, large = 0;
+
+	gmp_randinit_default(state);
+	array_init(&sample, 10);
+	test_assert("wrong sample size", array_sample_stdio(&sample, in, 101, 64, 0, 0, state, &count) == 101);
+	for (i = 0; i < sample.used; i++) {
+		if (mpz_sizeinbase(sample.array[i], 2) == 1024)
+			large++;
+	}
+	test_assert("wrong stratum share", large == 25);
+	test_assert("invalid sample", test_valid(&sample));
+	array_clear(&sample);
+
+	rewind(in);
+	array_init(&sample, 10);
+	array_sample_stdio(&sample, in, 10, 0, 1000, 2000, state, &count);
+	test_assert("wrong filtered count", count == 1000);
+	for (i = 0; i < sample.used; i++) {
+		test_assert("integer not filtered", mpz_sizeinbase(sample.array[i], 2) == 1024);
+	}
+	array_clear(&sample);
+
+	gmp_randclear(state);
+	fclose(in);
+	return 0;
+}
+
+// Execute all tests.
+int main(int argc, char **argv) {
+
+	printf("Starting sample test\n");
+
+	printf("Testing sample                 ");
+	test_evaluate(test_sample());
+
+	printf("Testing strata                 ");
+	test_evaluate(test_strata());
+
+	test_end();
+}
@@ -0,0 +1,65 @@
+// copri, Attacking RSA by factoring coprimes
+//
+// License: GNU Lesser General Public License (LGPL), version 3 or later
+// See the lgpl.txt file in the root directory or <https://www.gnu.org/licenses/lgpl>.
+
+// This is a test of the [source sidecar](source.html) of `csv2gmp`.
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <unistd.h>
+#include "test.h"
+#include "source.h"
+
+int tests_passed = 0;
+int tests_failed = 0;
+
+// **Test appending offsets** in two runs and looking them up.
+static char * test_append() {
+	source_map x;
+	FILE *out;
+	uint64_t offsets[1000];
+	size_t i;
+
+	for (i = 0; i < 1000; i++)
+		offsets[i] = (uint64_t)i * 0x100000007ULL;
+	unlink("test/test-source.src");
+	out = fopen("test/test-source.src", "a");
+	test_assert("wrong first write count", source_write(out, offsets, 600) == 600);
+	fclose(out);
+	out = fopen("test/test-source.src", "a");
+	test_assert("wrong second write count", source_write(out, offsets + 600, 400) == 400);
+	fclose(out);
+
+	test_assert("can't open the sidecar", source_open(&x, "test/test-source.src"));
+	test_assert("wrong count", x.count == 1000);
+	for (i = 0; i < 1000; i++) {
+		test_assert("wrong offset", source_offset(&x, i) == offsets[i]);
+	}
+	test_assert("offset behind the end", source_offset(&x, 1000) == SOURCE_NONE);
+	source_close(&x);
+	unlink("test/test-source.src");
+	return 0;
+}
+
+// **Test a missing sidecar**.
+static char * test_missing() {
+	source_map x;
+
+	test_assert("missing sidecar opened", !source_open(&x, "test/test-source.none"));
+	return 0;
+}
+
+// Execute all tests.
+int main(int argc, char **argv) {
+
+	printf("Starting source test\n");
+
+	printf("Testing append                 ");
+	test_evaluate(test_append());
+
+	printf("Testing missing sidecar        ");
+	test_evaluate(test_missing());
+
+	test_end();
+}
@@ -70,6 +70,41 @@ static char * test1() {
 	return 0;
 }
 
+// **Test `split_index`** on integers with 101, 101, 101 and 301 bits.
+static char * test_split_index() {
+	mpz_array in;
+	mpz_t b;
+	size_t i;
+
+	array_init(&in, 4);
+	mpz_init(b);
+	for (i=0;i<3;i++) {
+		mpz_ui_pow_ui(b, 2, 100);
+		array_add(&in, b);
+	}
+	mpz_ui_pow_ui(b, 2, 300);
+	array_add(&in, b);
+
+	// Split by count: two elements in each half.
+	if (split_index(in.array, 0, 3) != 1) {
+		return "wrong index for SPLIT_COUNT";
+	}
+
+	// Split by bits: the three small integers on the left.
+	set_split_mode(SPLIT_BITS);
+	if (split_index(in.array, 0, 3) != 2) {
+		return "wrong index for SPLIT_BITS";
+	}
+	if (split_index(in.array, 0, 1) != 0) {
+		return "wrong index for SPLIT_BITS on two elements";
+	}
+	set_split_mode(SPLIT_COUNT);
+
+	array_clear(&in);
+	mpz_clear(b);
+
+	return 0;
+}
 
 // Run all tests.
 int main(int argc, char **argv) {
@@ -79,5 +114,13 @@ int main(int argc, char **argv) {
 	printf("Test1                          ");
 	test_evaluate(test1());
 
+	printf("Test split_index               ");
+	test_evaluate(test_split_index());
+
+	printf("Test1 split by bits            ");
+	set_split_mode(SPLIT_BITS);
+	test_evaluate(test1());
+	set_split_mode(SPLIT_COUNT);
+
 	test_end();
 }
@@ -0,0 +1,123 @@
+// copri, Attacking RSA by factoring coprimes
+//
+// License: GNU Lesser General Public License (LGPL), version 3 or later
+// See the lgpl.txt file in the root directory or <https://www.gnu.org/licenses/lgpl>.
+
+// This is a test of the [streaming statistics](stats.html).
+#include <stdlib.h>
+#include <stdio.h>
+#include <gmp.h>
+#include "test.h"
+#include "stats.h"
+
+int tests_passed = 0;
+int tests_failed = 0;
+
+// **Test the counters** of 1000 integers of 64 bits and 10 of 128 bits.
+static char * test_counters() {
+	stream_stats st;
+	mpz_t x;
+	size_t i;
+
+	stats_init(&st, STATS_SMALL_BOUND);
+	mpz_init(x);
+	for (i = 0; i < 1010; i++) {
+		mpz_set_ui(x, 1);
+		mpz_mul_2exp(x, x, i < 1000 ? 63 : 127);
+		mpz_add_ui(x, x, 2 * i + 1);
+		stats_add(&st, x);
+	}
+	// 1009 * 1013 has no factor below 1000, 2 * 3 has.
+	mpz_set_ui(x, 1009 * 1013);
+	stats_add(&st, x);
+	mpz_set_si(x, -6);
+	stats_add(&st, x);
+
+	test_assert("wrong count", st.count == 1012);
+	test_assert("wrong min bits", st.min_bits == 3);
+	test_assert("wrong max bits", st.max_bits == 128);
+	test_assert("wrong histogram", st.histogram[64] == 1000 && st.histogram[128] == 10);
+	test_assert("wrong negative count", st.negative == 1);
+	test_assert("no small factors", st.small > 0 && st.small < st.count);
+
+	mpz_clear(x);
+	stats_clear(&st);
+	return 0;
+}
+
+// **Test the unique estimate** of 100000 integers with 50000 uniques, the
+// estimate has to be within 5%.
+static char * test_unique() {
+	stream_stats st, half;
+	mpz_t x;
+	size_t i;
+	double e;
+
+	stats_init(&st, STATS_SMALL_BOUND);
+	stats_init(&half, STATS_SMALL_BOUND);
+	mpz_init(x);
+	for (i = 0; i < 100000; i++) {
+		mpz_ui_pow_ui(x, 3, 100);
+		mpz_add_ui(x, x, i % 50000);
+		stats_add(i % 2 ? &st : &half, x);
+	}
+	stats_merge(&st, &half);
+	e = stats_unique(&st);
+	test_assert("wrong merged count", st.count == 100000);
+	test_assert("estimate too far off", e > 47500 && e < 52500);
+
+	stats_clear(&half);
+	stats_init(&half, STATS_SMALL_BOUND);
+	for (i = 0; i < 100; i++) {
+		mpz_set_ui(x, i);
+		stats_add(&half, x);
+	}
+	e = stats_unique(&half);
+	test_assert("small estimate too far off", e > 95 && e < 105);
+
+	mpz_clear(x);
+	stats_clear(&st);
+	stats_clear(&half);
+	return 0;
+}
+
+// **Test a stream** read in blocks.
+static char * test_stream() {
+	stream_stats st;
+	FILE *in = tmpfile();
+	mpz_t x;
+	size_t i;
+
+	mpz_init(x);
+	for (i = 0; i < 2 * STATS_BLOCK_SIZE + 17; i++) {
+		mpz_set_ui(x, 2 * i + 1);
+		mpz_out_raw(in, x);
+	}
+	rewind(in);
+	stats_init(&st, STATS_SMALL_BOUND);
+	test_assert("wrong read count", array_stats_stdio(&st, in) == 2 * STATS_BLOCK_SIZE + 17);
+	test_assert("wrong count", st.count == 2 * STATS_BLOCK_SIZE + 17);
+	test_assert("wrong min bits", st.min_bits == 1);
+
+	fclose(in);
+	mpz_clear(x);
+	stats_clear(&st);
+	return 0;
+}
+
+// Execute all tests.
+int main(int argc, char **argv) {
+
+	printf("Starting stats test\n");
+
+	printf("Testing counters               ");
+	test_evaluate(test_counters());
+
+	printf("Testing unique estimate        ");
+	test_evaluate(test_unique());
+
+	printf("Testing stream                 ");
+	test_evaluate(test_stream());
+
+	test_end();
+}